@@ -39,13 +39,12 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
-#include <avr/io.h>
-#include <avr/interrupt.h>
-
 #include <string.h>
 
 #include "PortMacros.h"
 #include "ACS712.h"
+#include "ADC.h"
+#include "EEPROM.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -56,24 +55,19 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 
 //
-// Full Speed AtoD at 16mHz = 8710 samples per second
-//
-// With 25 Ticks per second, taking 1 in 10 measurements is about 34 measurements per
-//   tick, which gives us 10+5 = 15 bits of resolution.
+// The AtoD scheduler (ADC.c) totals about 280 measurements per tick, which gives us
+//   well over 10+4 = 14 bits of resolution.
 //
 static struct {
     int16_t     Current;                            // Measured current, in Amps*10
-    uint16_t    Total;                              // Total AtoD in counted cycles
-    uint8_t     Cycles;                             // Number of cycles in total
-    uint8_t     SkipCount;                          // Cycles until next measurement
+    uint16_t    Counts;                             // Avg AtoD of last tick, Q4
+    uint8_t     IdleTicks;                          // Ticks output has been off
+    uint8_t     ZeroTicks;                          // Ticks in auto-zero total
+    uint32_t    ZeroTotal;                          // Auto-zero total, Q4
+    bool        Zeroed;                             // TRUE if zeroed this idle period
+    bool        Save;                               // TRUE if new zero is to be saved
     } ACS712 NOINIT;
 
-#define START_ATOD  { _SET_BIT(ADCSRA,ADSC); }      // Start the AtoD conversion
-#define ADMUX_VAL   (_PIN_MASK(REFS0) + ACS712_CHANNEL)
-
-#define DISABLE_INT _CLR_BIT(ADCSRA,_PIN_MASK(ADIE));   // Disable AtoD interrupts
-#define ENABLE_INT  _SET_BIT(ADCSRA,_PIN_MASK(ADIE));   // Enable  AtoD interrupts
-
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -86,71 +80,88 @@ static struct {
 void ACS712Init(void) {
 
     memset(&ACS712,0,sizeof(ACS712));
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ACS712AutoZero - Track the zero offset while the output is off
+//
+// Inputs:      TRUE if the output is off
+//
+// Outputs:     None.
+//
+static void ACS712AutoZero(bool Idle) {
 
-    ACS712.SkipCount = ACS712_SKIP;
+    if( !Idle ) {
+        ACS712.IdleTicks = 0;
+        ACS712.ZeroTicks = 0;
+        ACS712.ZeroTotal = 0;
+        ACS712.Zeroed    = false;
+        return;
+        }
+
+    if( ACS712.Zeroed )
+        return;
 
     //
-    // Setup AtoD channels for input
+    // Let the current decay before we start averaging
     //
-    _CLR_BIT(PRR,PRADC);                    // Powerup the A/D converter
+    if( ACS712.IdleTicks < ACS712_IDLE_TICKS ) {
+        ACS712.IdleTicks++;
+        return;
+        }
 
-    DIDR0  = 0;                             // Turn off digital outputs
-    ADCSRB = 0;                             // Free running mode
-    ADMUX  = ADMUX_VAL;                     // AVCC as ref, number of channels
-    ADCSRA = _PIN_MASK(ADPS2) | 
-             _PIN_MASK(ADPS1) | 
-             _PIN_MASK(ADPS0) |             // Prescale to 150 KHz
-             _PIN_MASK(ADEN)  |             // Enable, enable ints
-             _PIN_MASK(ADIE);
+    ACS712.ZeroTotal += ACS712.Counts;
+
+    if( ++ACS712.ZeroTicks < ACS712_ZERO_TICKS )
+        return;
 
     //
-    // Start the conversions
+    // Only save the new zero if it moved, to spare the EEPROM. The write takes
+    //   several ms a byte, so it's left for ACS712Save(), outside the tick.
     //
-    START_ATOD;
+    uint16_t Zero = ACS712.ZeroTotal >> ACS712_ZERO_SHIFT;
+    uint16_t Diff = Zero > EEPROM.ACS712Cal.Zero ? Zero - EEPROM.ACS712Cal.Zero
+                                                 : EEPROM.ACS712Cal.Zero - Zero;
+    if( Diff > ACS712_ZERO_WRITE ) {
+        EEPROM.ACS712Cal.Zero = Zero;
+        ACS712.Save           = true;
+        }
+
+    ACS712.Zeroed = true;
     }
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// ACS712GetCurrent - Return ACS712 Current values
+// ACS712Update - Update ACS712 current values
 //
-// Inputs:      None.
+// Inputs:      TRUE if the output is off, and the sensor may be auto-zeroed
 //
-// Outputs:     ACS712 Current in Amps*10
+// Outputs:     None.
 //
-void ACS712Update(void) {
-
-    DISABLE_INT;
+void ACS712Update(bool Idle) {
 
-    int16_t ACS712Total  = ACS712.Total;
-    uint8_t ACS712Cycles = ACS712.Cycles;
+    ACS712.Counts = ADCGetAvg(ADC_CURRENT);
 
-    ACS712.Total  = 0;
-    ACS712.Cycles = 0;
-
-    ENABLE_INT;
+    ACS712AutoZero(Idle);
 
     //
-    // The AtoD reading is proportional to 1023 with 
-
-#define MAX_ADC 0x3FF
-#define VADC    500             // == 5 volts x 100
-
-    int32_t Voltage = (((int32_t) ACS712Total)*VADC)/(MAX_ADC*ACS712Cycles);
-
+    // In normal  mode, a reading above the zero point is positive current.
     //
-    // In normal  mode, a reading of 512 represents zero and positive current is greater.
-    //
-    // In reverse mode, 512 represents zero and positive current is lessor
+    // In reverse mode, a reading below the zero point is positive current.
     //
 #ifdef ACS712_REVERSE
-    ACS712.Current = 250 - Voltage;
+    int16_t Delta = EEPROM.ACS712Cal.Zero - ACS712.Counts;
 #else
-    ACS712.Current = Voltage - 250;
+    int16_t Delta = ACS712.Counts - EEPROM.ACS712Cal.Zero;
 #endif
-    }
 
+    ACS712.Current = (((int32_t) Delta)*EEPROM.ACS712Cal.Gain + 0x8000) >> 16;
+    }
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -168,30 +179,77 @@ uint16_t ACS712GetCurrent(void) { return ACS712.Current; }
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// ADC_vect - A/D interrupt processing
+// ACS712GetCounts - Return raw averaged reading
+//
+// Inputs:      None.
 //
-// Inputs:      None. (ISR)
+// Outputs:     Average AtoD reading from last tick, Q4 counts
+//
+uint16_t ACS712GetCounts(void) { return ACS712.Counts; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ACS712Zero - Re-null the zero offset during the next idle period
+//
+// Inputs:      None.
 //
 // Outputs:     None.
 //
-ISR(ADC_vect,ISR_NOBLOCK) {
+void ACS712Zero(void) { ACS712AutoZero(false); }
 
-    //
-    // Start the next conversion
-    //
-    START_ATOD;
 
-    //
-    // Save resolution by only measuring 1-in-SKIP_MAX cycles
-    //
-    if( --ACS712.SkipCount > 0 )
-        return;
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ACS712Save - Save a new auto-zero to EEPROM, if there is one
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+// Called from the main loop, between ticks. Only the calibration is written.
+//
+void ACS712Save(void) {
 
-    ACS712.SkipCount = ACS712_SKIP;
+    if( ACS712.Save ) {
+        ACS712.Save = false;
+        EEPROMWriteField(EEPROM.ACS712Cal);
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ACS712SetGain - Calibrate gain against a known current
+//
+// Inputs:      Actual current flowing, in Amps x 10
+//
+// Outputs:     TRUE  if gain was set and saved to EEPROM
+//              FALSE if the present reading is too close to zero to calibrate
+//
+bool ACS712SetGain(uint16_t Current) {
+
+#ifdef ACS712_REVERSE
+    int16_t Delta = EEPROM.ACS712Cal.Zero - ACS712.Counts;
+#else
+    int16_t Delta = ACS712.Counts - EEPROM.ACS712Cal.Zero;
+#endif
 
     //
-    // Total up the count and return
+    // Need at least a few AtoD counts of signal for a meaningful gain
     //
-    ACS712.Cycles++;
-    ACS712.Total += ADC;
+    if( Delta < 4*16 || Current == 0 )
+        return false;
+
+    uint32_t Gain = (((uint32_t) Current) << 16)/Delta;
+
+    if( Gain > 0xFFFF )
+        return false;
+
+    EEPROM.ACS712Cal.Gain = Gain;
+    EEPROMWriteField(EEPROM.ACS712Cal);
+    return true;
     }
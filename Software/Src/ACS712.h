@@ -13,15 +13,15 @@
 //      //
 //      // In ACS712.h
 //      //
-//      ...Choose AtoD channel              (Default: ADC0)
-//      ...Choose skip count                (Default: 10)
 //      ...Choose pos or neg mode           (Default: Neg)
+//      ...Choose auto-zero timing          (Default: see below)
 //      
 //      //////////////////////////////////////
 //      //
 //      // In Main.c
 //      //
 //      TimerInit();
+//      ADCInit();
 //      ACS712Init();                       // Called once at startup
 //          :
 //
@@ -29,15 +29,32 @@
 //          while( !TimerUpdate() )
 //              sleep_cpu();                // Wait for tick to happen
 //
-//          ACS712Update();                 // Update current calculations
+//          ADCUpdate();
+//          ACS712Update(Idle);             // Update current calculations
 //          }
 //
 //      Current = ACS712GetCurrent();       // Return avg current from last tick
 //
+//      ACS712Zero();                       // Re-null at next idle period
+//      ACS712SetGain(Current);             // Calibrate gain against known current
 //
 //  DESCRIPTION
 //
 //      Simple ACS712 current measurement
+//
+//      Each unit's zero point differs from the nominal 2.50V by the sensor and
+//        reference tolerance, so the zero offset and gain are kept per unit in
+//        EEPROM (ACS712_CAL).
+//
+//      The zero is found automatically: once the output has been off (Idle) for
+//        ACS712_IDLE_TICKS, the mean reading is averaged over ACS712_ZERO_TICKS and
+//        becomes the new zero. This happens once per idle period, and the EEPROM is
+//        only written if the zero moved by more than ACS712_ZERO_WRITE. Only the
+//        calibration is written, from the main loop between ticks (ACS712Save).
+//
+//      Readings are kept as Q4 counts (AtoD counts x 16), and the gain is a Q16
+//        multiplier giving Amps x 10 per Q4 count, so the tick path is one subtract,
+//        one multiply, and one shift.
 //
 //  SYNOPSIS
 //
@@ -73,21 +90,39 @@
 #define ACS712_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// Specify a n AtoD channel to use
+// The AtoD channel is set in ADC.h (ADC_CURRENT_CHANNEL)
 //
-#define ACS712_CHANNEL  0
-
-#define ACS712_SKIP     16                          // Count one out of every 10
 
 //
 // Uncomment this next if the current goes forward through the chip in the wrong
 //   direction.
 //
 #define ACS712_REVERSE
+
+//
+// Nominal calibration: 2.50V zero and 100 mV/A, in Q4 AtoD counts
+//
+#define ACS712_DEF_ZERO     8184                    // 511.5 counts x 16
+#define ACS712_DEF_GAIN     2002                    // (500/1023/16) x 65536
+
+//
+// Largest current the chip reads, in Amps x 10: 2.50V either side of zero, at 100 mV/A
+//
+#define ACS712_MAX_CURRENT  250
+
+//
+// Auto-zero: Output must be off for IDLE_TICKS, then average over ZERO_TICKS
+//
+#define ACS712_IDLE_TICKS   25                      // ~1 second
+#define ACS712_ZERO_SHIFT   6
+#define ACS712_ZERO_TICKS   (1 << ACS712_ZERO_SHIFT) // ~2.5 seconds
+#define ACS712_ZERO_WRITE   16                      // Q4 counts change before saving
+                                                    //   (1 LSB, 4x the average's noise)
 
 //
 // End of user configurable options
@@ -95,6 +130,16 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Per-unit calibration, kept in EEPROM
+//
+typedef struct {
+    uint16_t    Zero;                               // Zero current reading, Q4 counts
+    uint16_t    Gain;                               // Amps x 10 per Q4 count, Q16
+    } ACS712_CAL;
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -112,11 +157,11 @@ void ACS712Init(void);
 //
 // ACS712Update - Update ACS712 current values
 //
-// Inputs:      None
+// Inputs:      TRUE if the output is off, and the sensor may be auto-zeroed
 //
 // Outputs:     None.
 //
-void ACS712Update(void);
+void ACS712Update(bool Idle);
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -129,5 +174,55 @@ void ACS712Update(void);
 // Outputs:     Average current since last request
 //
 uint16_t ACS712GetCurrent(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ACS712GetCounts - Return raw averaged reading
+//
+// Inputs:      None
+//
+// Outputs:     Average AtoD reading from last tick, Q4 counts
+//
+uint16_t ACS712GetCounts(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ACS712Zero - Re-null the zero offset during the next idle period
+//
+// Inputs:      None
+//
+// Outputs:     None.
+//
+void ACS712Zero(void);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ACS712Save - Save a new auto-zero to EEPROM, if there is one
+//
+// Inputs:      None
+//
+// Outputs:     None.
+//
+// Call from the main loop, outside the tick: an EEPROM write takes several ms.
+//
+void ACS712Save(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ACS712SetGain - Calibrate gain against a known current
+//
+// Inputs:      Actual current flowing, in Amps x 10
+//
+// Outputs:     TRUE  if gain was set and saved to EEPROM
+//              FALSE if the present reading is too close to zero to calibrate
+//
+bool ACS712SetGain(uint16_t Current);
 
 #endif  // ACS712_H - entire file
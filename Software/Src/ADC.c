@@ -0,0 +1,274 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      ADC.c - Interrupt driven AtoD scheduler
+//
+//  SYNOPSIS
+//
+//      See ADC.h for details
+//
+//  DESCRIPTION
+//
+//      Share the AtoD between several channels
+//
+//  VERSION:    2015.08.22
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "PortMacros.h"
+#include "ADC.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data declarations
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// Full Speed AtoD at 16mHz = 9615 samples per second
+//
+// With the default slot sizes, current gets 8 of every 11 conversions, or about
+//   280 samples per tick. A temperature visit (once a second) costs about 330
+//   conversions, or 34 ms, nearly all discarded while the reference settles.
+//
+typedef struct {
+    uint8_t     Mux;                                // ADMUX value (ref + channel)
+    uint8_t     Samples;                            // Samples per visit
+    bool        OneShot;                            // TRUE if only visited on request
+    } ADC_SLOT_DEF;
+
+#define AVCC_REF    _PIN_MASK(REFS0)
+#define INT_REF     (_PIN_MASK(REFS1) | _PIN_MASK(REFS0))
+
+static const ADC_SLOT_DEF ADCSlotDefs[NUM_ADC_SLOTS] = {
+    { AVCC_REF + ADC_CURRENT_CHANNEL, ADC_CURRENT_SAMPLES, false },
+    { AVCC_REF + ADC_VCC_CHANNEL    , ADC_VCC_SAMPLES    , false },
+    { INT_REF  + ADC_TEMP_CHANNEL   , ADC_TEMP_SAMPLES   , true  },
+    };
+
+static struct {
+    uint32_t    Total;                              // Total AtoD in counted samples
+    uint16_t    Count;                              // Number of samples in total
+    uint16_t    Avg;                                // Average from last tick, Q4
+    } ADCSlots[NUM_ADC_SLOTS] NOINIT;
+
+static struct {
+    ADC_SLOT    Slot;                               // Slot being converted
+    uint16_t    Discard;                            // Conversions left to discard
+    uint8_t     Samples;                            // Samples left in this visit
+    uint8_t     Requests;                           // Mask of requested one-shot slots
+    } ADCSched NOINIT;
+
+#define REF_MASK    (_PIN_MASK(REFS1) | _PIN_MASK(REFS0))
+#define SLOT_MASK(_x_)  _PIN_MASK(_x_)
+
+//
+// ADIF is cleared by writing a 1, so a plain read-modify-write of ADCSRA would discard
+//   a conversion that completed while interrupts were off, and stop the conversion
+//   chain. Always write ADIF back as zero.
+//
+#define ADCSRA_RMW(_set_,_clr_) { ADCSRA = (ADCSRA & ~(_PIN_MASK(ADIF) | (_clr_))) | (_set_); }
+
+#define START_ATOD  ADCSRA_RMW(_PIN_MASK(ADSC),0)   // Start the AtoD conversion
+
+#define DISABLE_INT ADCSRA_RMW(0,_PIN_MASK(ADIE))   // Disable AtoD interrupts
+#define ENABLE_INT  ADCSRA_RMW(_PIN_MASK(ADIE),0)   // Enable  AtoD interrupts
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADCInit - Initialize AtoD scheduler, and start conversions
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void ADCInit(void) {
+
+    memset(ADCSlots,0,sizeof(ADCSlots));
+    memset(&ADCSched,0,sizeof(ADCSched));
+
+    ADCSched.Slot    = ADC_CURRENT;
+    ADCSched.Discard = ADC_REF_DISCARD;
+    ADCSched.Samples = ADCSlotDefs[ADC_CURRENT].Samples;
+
+    //
+    // Setup AtoD channels for input
+    //
+    _CLR_BIT(PRR,PRADC);                    // Powerup the A/D converter
+
+    DIDR0  = _PIN_MASK(ADC_CURRENT_CHANNEL) |
+             _PIN_MASK(ADC_VCC_CHANNEL);    // Turn off digital inputs
+    ADCSRB = 0;                             // Free running mode
+    ADMUX  = ADCSlotDefs[ADC_CURRENT].Mux;  // AVCC as ref, first channel
+    ADCSRA = _PIN_MASK(ADPS2) |
+             _PIN_MASK(ADPS1) |
+             _PIN_MASK(ADPS0) |             // Prescale to 125 KHz
+             _PIN_MASK(ADEN)  |             // Enable, enable ints
+             _PIN_MASK(ADIE);
+
+    //
+    // Start the conversions
+    //
+    START_ATOD;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADCUpdate - Collect slot averages from the last tick
+//
+// Inputs:      None. (Called once per tick)
+//
+// Outputs:     None.
+//
+void ADCUpdate(void) {
+
+    for( uint8_t Slot = 0; Slot < NUM_ADC_SLOTS; Slot++ ) {
+
+        DISABLE_INT;
+
+        uint32_t Total = ADCSlots[Slot].Total;
+        uint16_t Count = ADCSlots[Slot].Count;
+
+        ADCSlots[Slot].Total = 0;
+        ADCSlots[Slot].Count = 0;
+
+        ENABLE_INT;
+
+        if( Count )
+            ADCSlots[Slot].Avg = (Total << 4)/Count;
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADCGetAvg - Return average reading of slot
+//
+// Inputs:      Slot to return
+//
+// Outputs:     Average AtoD reading from last tick with samples, Q4 counts
+//
+uint16_t ADCGetAvg(ADC_SLOT Slot) { return ADCSlots[Slot].Avg; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADCRequest - Request one visit to a one-shot slot
+//
+// Inputs:      Slot to visit
+//
+// Outputs:     None.
+//
+void ADCRequest(ADC_SLOT Slot) {
+
+    DISABLE_INT;
+    ADCSched.Requests |= SLOT_MASK(Slot);
+    ENABLE_INT;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADCNextSlot - Switch the mux to the next slot
+//
+// Inputs:      None. (Called from ISR, with the AtoD idle)
+//
+// Outputs:     None.
+//
+static void ADCNextSlot(void) {
+
+    //
+    // A one-shot visit is done once its samples are in
+    //
+    ADCSched.Requests &= ~SLOT_MASK(ADCSched.Slot);
+
+    //
+    // Skip one-shot slots that nobody asked for. The first slot is always continuous,
+    //   so this terminates.
+    //
+    do {
+        if( ++ADCSched.Slot >= NUM_ADC_SLOTS )
+            ADCSched.Slot = 0;
+        } while( ADCSlotDefs[ADCSched.Slot].OneShot &&
+                 !(ADCSched.Requests & SLOT_MASK(ADCSched.Slot)) );
+
+    uint8_t Mux = ADCSlotDefs[ADCSched.Slot].Mux;
+
+    if( (Mux ^ ADMUX) & REF_MASK ) ADCSched.Discard = (Mux & REF_MASK) == INT_REF ?
+                                                      ADC_REF_DISCARD : ADC_AVCC_DISCARD;
+    else                           ADCSched.Discard = ADC_MUX_DISCARD;
+
+    ADCSched.Samples = ADCSlotDefs[ADCSched.Slot].Samples;
+    ADMUX            = Mux;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADC_vect - A/D interrupt processing
+//
+// Inputs:      None. (ISR)
+//
+// Outputs:     None.
+//
+ISR(ADC_vect,ISR_NOBLOCK) {
+
+    //
+    // Conversions right after a switch are unsettled, throw them away
+    //
+    if( ADCSched.Discard )
+        ADCSched.Discard--;
+    else {
+        ADCSlots[ADCSched.Slot].Total += ADC;
+        ADCSlots[ADCSched.Slot].Count++;
+
+        if( --ADCSched.Samples == 0 )
+            ADCNextSlot();
+        }
+
+    //
+    // Start the next conversion, on the (possibly new) channel
+    //
+    START_ATOD;
+    }
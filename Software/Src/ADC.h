@@ -0,0 +1,178 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      ADC.h - Interrupt driven AtoD scheduler
+//
+//  SYNOPSIS
+//
+//      //////////////////////////////////////
+//      //
+//      // In ADC.h
+//      //
+//      ...Choose AtoD channels             (Default: see below)
+//      ...Choose samples per slot visit    (Default: see below)
+//
+//      //////////////////////////////////////
+//      //
+//      // In Main.c
+//      //
+//      ADCInit();                          // Called once at startup
+//          :
+//
+//      while(1) {
+//          while( !TimerUpdate() )
+//              sleep_cpu();                // Wait for tick to happen
+//
+//          ADCUpdate();                    // Collect averages from last tick
+//          }
+//
+//      Avg = ADCGetAvg(ADC_CURRENT);       // Return avg reading from last tick
+//
+//      ADCRequest(ADC_TEMP);               // Sample a one-shot slot once
+//
+//  DESCRIPTION
+//
+//      The AtoD runs continuously from its interrupt, and each conversion is assigned
+//        to a "slot" (a channel and reference). Slots are visited in turn: on each
+//        visit the mux is switched, a few conversions are discarded while the input
+//        settles, and then a fixed number of samples are totaled for that slot.
+//
+//      One-shot slots are only visited when requested with ADCRequest(), for channels
+//        that need to be read only occasionally.
+//
+//      Switching the reference needs much longer to settle than switching the
+//        channel, so more conversions are discarded when the reference changes.
+//
+//      Once per tick, ADCUpdate() converts each slot's total into an average in Q4
+//        (AtoD counts x 16). A slot with no samples keeps its previous average.
+//
+//  VERSION:    2015.08.22
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ADC_H
+#define ADC_H
+
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// AtoD channels
+//
+#define ADC_CURRENT_CHANNEL     0           // ACS712 current sensor
+#define ADC_VCC_CHANNEL         1           // Supply voltage divider
+#define ADC_TEMP_CHANNEL        8           // Internal temperature sensor (1.1V ref)
+
+//
+// Samples totaled on each visit to a slot
+//
+#define ADC_CURRENT_SAMPLES     8
+#define ADC_VCC_SAMPLES         1
+#define ADC_TEMP_SAMPLES        8
+
+//
+// Conversions to discard after switching the mux, or the reference (104 us each).
+//
+// Going to the 1.1V reference, AREF's 100 nF cap discharges from 5V through the
+//   reference's ~32K (a 3.2 ms time constant), and needs about 8 time constants to
+//   settle to 10 bits. Going back to AVcc, it's charged through the AVcc switch, which
+//   is much quicker.
+//
+#define ADC_MUX_DISCARD         1
+#define ADC_REF_DISCARD         288         // ~30 ms, to the 1.1V reference
+#define ADC_AVCC_DISCARD        32          // ~3.5 ms, back to AVcc
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// AtoD slots, in the order visited
+//
+typedef enum {
+    ADC_CURRENT = 0,        // ACS712 current
+    ADC_VCC,                // Supply voltage
+    ADC_TEMP,               // Internal temperature (one-shot)
+    NUM_ADC_SLOTS
+    } ADC_SLOT;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADCInit - Initialize AtoD scheduler, and start conversions
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void ADCInit(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADCUpdate - Collect slot averages from the last tick
+//
+// Inputs:      None. (Called once per tick)
+//
+// Outputs:     None.
+//
+void ADCUpdate(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADCGetAvg - Return average reading of slot
+//
+// Inputs:      Slot to return
+//
+// Outputs:     Average AtoD reading from last tick with samples, Q4 counts
+//
+uint16_t ADCGetAvg(ADC_SLOT Slot);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ADCRequest - Request one visit to a one-shot slot
+//
+// Inputs:      Slot to visit
+//
+// Outputs:     None.
+//
+void ADCRequest(ADC_SLOT Slot);
+
+
+#endif  // ADC_H - entire file
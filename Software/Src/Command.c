@@ -67,6 +67,7 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
@@ -76,6 +77,18 @@
 #include "Command.h"
 #include "Screen.h"
 #include "Parse.h"
+#include "UART.h"
+#include "SerialLong.h"
+#include "Telemetry.h"
+#include "SG3525.h"
+#include "Setup.h"
+#include "Fault.h"
+#include "Format.h"
+#include "ACS712.h"
+#include "Thermal.h"
+#include "Query.h"
+#include "Macro.h"
+#include "Stream.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -96,7 +109,7 @@
 //
 // IsDelimiter() macro
 //
-#define IsDelimiter(__char__)   strchr(DELIMITERS,__char__)
+#define IsDelimiter(__char__)   ((__char__) != 0 && strchr(DELIMITERS,__char__))
 
 static char     CommandBuffer[MAX_CMD_LENGTH+1] NOINIT;
 static uint8_t  nChars                          NOINIT;
@@ -171,131 +184,461 @@ void CommandInit(void) {
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// Command - Process text command
+// ScreenCmd - MA, HE, DE, ME, EE - Show a screen
 //
-// Inputs:      Line command to process
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
 //
 // Outputs:     None.
 //
-void Command(char *Buffer) {
+// "?" is the help screen, and ESC (off the main screen) goes back to the main screen.
+//
+static void ScreenCmd(uint8_t Argc,char *Argv[]) {
+    char *Name = Argv[0];
 
-    ParseInit(Buffer);
+    if     ( Name[0] == '?' ) ShowScreen('HE');
+    else if( Name[0] == ESC ) ShowScreen('MA');
+    else                      ShowScreen((Name[0] << 8) | Name[1]);
+    }
 
-    char *Command = ParseToken();
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// BaudCmd - BA - Set the serial baud rate
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// Echo and replies already queued go out at the old rate. The new rate is confirmed
+//   at the new rate, once the host has switched over.
+//
+static void BaudCmd(uint8_t Argc,char *Argv[]) {
+    char    *BaudText = Argv[1];
+    uint32_t BaudNum  = atol(BaudText);
 
-#ifdef USE_MAIN_SCREEN
-    //
-    // MA - Show the main screen
-    //
-    if( StrEQ(Command,"MA") ) {
-        ShowScreen('MA');
+    while( SerialPending(SERIAL_HI) && !UARTStopped() )
+        SerialPump();
+
+    CursorPos(1,ERROR_ROW);
+    ClearEOL;
+    if( !UARTSetBaud(BaudNum) ) {
+        PrintStringP(PSTR("Bad or unreachable baud rate ("));
+        PrintString(BaudText);
+        PrintStringP(PSTR("), try 19200, 250000, 500000 or 1000000\r\n"));
         return;
         }
 
-#ifdef USE_MAIN_SCREEN_CMDS
-    //
-    // See if the local screen can manage the command
-    //
-    if( SelectedScreen == 'MA' ) {
-        if( MAScreenCommand(Command) )
-            return;
-        }
+    PrintStringP(PSTR("Baud rate "));
+    PrintLD(UARTGetBaud(),0);
+    }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FlowCmd - FL - Show, or turn on or off, XON/XOFF flow control
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+static void FlowCmd(uint8_t Argc,char *Argv[]) {
+    char *FlowText = Argv[1];
+
+    CursorPos(1,ERROR_ROW);
+    ClearEOL;
 
     //
-    // Universally accept <ESC> as an escape to the main screen.
+    // Telemetry frames may contain XON and XOFF bytes, which the host would eat
     //
-    if( StrEQ(Command,ESC_CMD) ) {
-        ShowScreen('MA');
+    if( StrEQ(FlowText,"ON") && TelemOn() ) {
+        PrintStringP(PSTR("Turn telemetry off first (TM 0)\r\n"));
         return;
         }
+
+    if     ( StrEQ(FlowText,"ON") ) UARTSetFlow(true);
+    else if( StrEQ(FlowText,"OF") ) UARTSetFlow(false);
+
+    PrintStringP(PSTR("Flow control "));
+    if( UARTGetFlow() ) PrintStringP(PSTR("ON" ));
+    else                PrintStringP(PSTR("OFF"));
+    }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command table, sorted by name in ASCII order (as strcmp() sees it), so that a name
+//   is found by binary search: 6 compares at most, for any command.
+//
+// Each entry has the screens it may be used on. A name may appear more than once for
+//   different screens (such as ESC), and the first entry for the selected screen wins.
+//
+// MA_CMD() entries are for the main screen only, ALL_CMD() entries for every screen.
+//
+// The first argument is checked by the dispatcher, as the entry says:
+//
+//      NO_ARG                  Not checked, the handler deals with any arguments
+//      NUM_ARG(unit,lo,hi,var) A number from lo to hi, stored in var (if not NULL)
+//      OPT_ARG(lo,hi)          A whole number from lo to hi, or nothing
+//
+// The unit (UNIT_xx, see Parse.h) says which suffixes the number may have, so that
+//   "FR 28.5k" and "PO 25W" are converted to Hz and watts x 10.
+//
+// Then the handler (if not NULL) is called. A command that only sets a variable,
+//   such as FR, needs no handler at all.
+//
+// The help line is listed on the help screen, or NULL to leave the command out. It
+//   has the arguments in the first 7 columns, then a description.
+//
+#ifdef USE_MAIN_SCREEN_CMDS
+#define MA_CMD(_name_,_arg_,_fn_,_help_)    { _name_, SCREEN_MA , _arg_, _fn_, _help_ },
+#else
+#define MA_CMD(_name_,_arg_,_fn_,_help_)
+#endif
+
+#define ALL_CMD(_name_,_arg_,_fn_,_help_)   { _name_, SCREEN_ALL, _arg_, _fn_, _help_ },
+
+#define NO_ARG                          ARG_NONE, UNIT_NONE, 0   , 0   , NULL
+#define NUM_ARG(_unit_,_lo_,_hi_,_var_) ARG_NUM , _unit_   , _lo_, _hi_, _var_
+#define OPT_ARG(_lo_,_hi_)              ARG_OPT , UNIT_NONE, _lo_, _hi_, NULL
+#define TEXT_ARG                        ARG_TEXT, UNIT_NONE, 0   , 0   , NULL
+
+typedef enum {
+    ARG_NONE = 0,                           // No check
+    ARG_NUM,                                // Number, from Min to Max
+    ARG_OPT,                                // Number, from Min to Max, or nothing
+    ARG_TEXT,                               // A word, then the rest of the line as typed
+    } ARG_TYPE;
+
+typedef struct {
+    char        Name[4];                    // Upper case, NUL terminated
+    uint8_t     Screens;                    // SCREEN_xx mask of screens it's used on
+    ARG_TYPE    Arg;                        // Type of the first argument
+    UNIT        Unit;                       // Unit of a number argument
+    uint16_t    Min;                        // Range of a number argument
+    uint16_t    Max;
+    uint16_t   *Var;                        // Where a number argument goes, or NULL
+    COMMAND_FN  Fn;                         // Handler, or NULL
+    PGM_P       Help;                       // Help line, or NULL if not listed
+    } COMMAND_DEF;
+
+//
+// Help lines. Some belong to commands that are compiled out, hence "unused".
+//
+#define HELP_TEXT   static const char __attribute__((unused)) PROGMEM
+
+HELP_TEXT HelpU  [] = "       Coarse freq wiper up, D down";
+HELP_TEXT HelpW  [] = "       PWM wiper wider, N narrower";
+HELP_TEXT HelpAdj[] = "       Fine freq wiper up, - down";
+HELP_TEXT HelpAG [] = "#      Set current gain (amps x 10)";
+HELP_TEXT HelpAZ [] = "       Re-zero current sensor";
+HELP_TEXT HelpBA [] = "#      Set serial baud rate";
+HELP_TEXT HelpCL [] = "       Clear the message area";
+HELP_TEXT HelpDE [] = "       Show the debug screen";
+HELP_TEXT HelpEE [] = "       Dump the EEPROM memory";
+HELP_TEXT HelpFA [] = "[C]    Show/clear faults";
+HELP_TEXT HelpFCW[] = "#      Set freq coarse wiper";
+HELP_TEXT HelpFFW[] = "#      Set freq fine wiper";
+HELP_TEXT HelpFI [] = "xx     Inject fault (OP SH LK BO OT)";
+HELP_TEXT HelpFL [] = "ON|OF  Set XON/XOFF flow control";
+HELP_TEXT HelpFR [] = "#      Set frequency (Hz, or 28.5k)";
+HELP_TEXT HelpHE [] = "       Show this help panel";
+HELP_TEXT HelpLK [] = "[C]    Show/clear freq lock stats";
+HELP_TEXT HelpLS [] = "[#]    Load setup #, or reload";
+HELP_TEXT HelpMA [] = "       Show the main screen";
+HELP_TEXT HelpMD [] = "[x ..] Set/clear macro x, or list";
+HELP_TEXT HelpME [] = "       Dump the RAM memory";
+HELP_TEXT HelpMM [] = "       Machine GET/SET mode (EXIT)";
+HELP_TEXT HelpMO [] = "[...]  Mode: R RT # CF CA I1 I2";
+HELP_TEXT HelpOF [] = "       Turn transducer off";
+HELP_TEXT HelpON [] = "       Turn transducer on";
+HELP_TEXT HelpPO [] = "#      Power: W x 10, or 25.5W, 35%";
+HELP_TEXT HelpPS [] = "[#]    Print setup # or current";
+HELP_TEXT HelpPW [] = "#      Set power wiper";
+HELP_TEXT HelpSP [] = "[#|S]  Setpoint stream; S stats";
+HELP_TEXT HelpSS [] = "[#]    Save setup #, or current";
+HELP_TEXT HelpST [] = "[C|A]  Stage, then C commit, A abort";
+HELP_TEXT HelpTC [] = "#      Calibrate board temp (deg C)";
+HELP_TEXT HelpTM [] = "[xx|KF] # Telemetry every #, 0=off";
+
+static const COMMAND_DEF Commands[] PROGMEM = {
+    MA_CMD (ESC_CMD,NO_ARG,SG3525OffCmd,NULL)
+#ifdef USE_MAIN_SCREEN
+    { ESC_CMD, SCREEN_ALL & ~SCREEN_MA, NO_ARG, ScreenCmd, NULL },
+#endif
+#ifdef USE_ADJ_CMDS
+    MA_CMD ("+"  ,NO_ARG,SG3525AdjCmd,HelpAdj)
+    MA_CMD ("-"  ,NO_ARG,SG3525AdjCmd,NULL)
+#endif
+#ifdef USE_HELP_SCREEN
+    ALL_CMD("?"  ,NO_ARG,ScreenCmd,NULL)
 #endif
+    MA_CMD ("AG" ,NUM_ARG(UNIT_NONE,1,ACS712_MAX_CURRENT,NULL),SG3525GainCmd,HelpAG)
+    MA_CMD ("AZ" ,NO_ARG,SG3525ZeroCmd,HelpAZ)
+    ALL_CMD("BA" ,NO_ARG,BaudCmd,HelpBA)
+    MA_CMD ("CL" ,NO_ARG,MAClearCmd,HelpCL)
+#ifdef USE_ADJ_CMDS
+    MA_CMD ("D"  ,NO_ARG,SG3525AdjCmd,NULL)
 #endif
+#ifdef USE_DEBUG_SCREEN
+    ALL_CMD("DE" ,NO_ARG,ScreenCmd,HelpDE)
+#endif
+#ifdef USE_EEPROM_SCREEN
+    ALL_CMD("EE" ,NO_ARG,ScreenCmd,HelpEE)
+#endif
+    MA_CMD ("FA" ,NO_ARG,FaultCmd,HelpFA)
+#ifdef USE_WIPER_CMDS
+    MA_CMD ("FCW",NUM_ARG(UNIT_NONE,0,FreqCPot_MAX_WIPER,&SG3525Curr.FreqCWiper),SG3525WiperCmd,HelpFCW)
+    MA_CMD ("FFW",NUM_ARG(UNIT_NONE,0,FreqFPot_MAX_WIPER,&SG3525Curr.FreqFWiper),SG3525WiperCmd,HelpFFW)
+#endif
+#ifdef USE_FAULT_INJECT
+    MA_CMD ("FI" ,NO_ARG,FaultInjectCmd,HelpFI)
+#endif
+    ALL_CMD("FL" ,NO_ARG,FlowCmd,HelpFL)
+    MA_CMD ("FR" ,NUM_ARG(UNIT_HZ,SG3525_MIN_FREQ,SG3525_MAX_FREQ,&SG3525Set.Freq),NULL,HelpFR)
+#ifdef USE_HELP_SCREEN
+    ALL_CMD("HE" ,NO_ARG,ScreenCmd,HelpHE)
+#endif
+    MA_CMD ("LK" ,NO_ARG,SG3525LockCmd,HelpLK)
+    MA_CMD ("LS" ,OPT_ARG(0,MAX_SETUPS-1),SetupLoadCmd,HelpLS)
+#ifdef USE_MAIN_SCREEN
+    ALL_CMD("MA" ,NO_ARG,ScreenCmd,HelpMA)
+#endif
+    MA_CMD ("MD" ,TEXT_ARG,MacroCmd,HelpMD)
+#ifdef USE_MEMORY_SCREEN
+    ALL_CMD("ME" ,NO_ARG,ScreenCmd,HelpME)
+#endif
+    ALL_CMD("MM" ,NO_ARG,QueryCmd,HelpMM)
+    MA_CMD ("MO" ,NO_ARG,SetupModeCmd,HelpMO)
+#ifdef USE_ADJ_CMDS
+    MA_CMD ("N"  ,NO_ARG,SG3525AdjCmd,NULL)
+#endif
+    MA_CMD ("OF" ,NO_ARG,SG3525OffCmd,HelpOF)
+    MA_CMD ("ON" ,NO_ARG,SG3525OnCmd,HelpON)
+    MA_CMD ("PO" ,NUM_ARG(UNIT_POWER,SG3525_MIN_POWER,SG3525_MAX_POWER,&SG3525Set.Power),NULL,HelpPO)
+    MA_CMD ("PS" ,OPT_ARG(0,MAX_SETUPS-1),SetupPrintCmd,HelpPS)
+#ifdef USE_WIPER_CMDS
+    MA_CMD ("PW" ,NUM_ARG(UNIT_NONE,0,PWMPot_MAX_WIPER,&SG3525Curr.PWMWiper),SG3525WiperCmd,HelpPW)
+#endif
+    MA_CMD ("SP" ,NO_ARG,StreamCmd,HelpSP)
+    MA_CMD ("SS" ,OPT_ARG(0,MAX_SETUPS-1),SetupSaveCmd,HelpSS)
+    MA_CMD ("ST" ,NO_ARG,SG3525StageCmd,HelpST)
+    MA_CMD ("TC" ,NUM_ARG(UNIT_NONE,1,THERMAL_TRIP_TEMP-1,NULL),SG3525TempCmd,HelpTC)
+    ALL_CMD("TM" ,NO_ARG,TelemCmd,HelpTM)
+#ifdef USE_ADJ_CMDS
+    MA_CMD ("U"  ,NO_ARG,SG3525AdjCmd,HelpU)
+    MA_CMD ("W"  ,NO_ARG,SG3525AdjCmd,HelpW)
+#endif
+    MA_CMD ("XX" ,NO_ARG,SG3525XXCmd,NULL)
+    };
 
 //////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FindCommand - Look up a command for a set of screens
+//
+// Inputs:      Command name, in upper case
+//              Where to put the table entry, if found
+//              Screens to look for (ScreenMask(), or SCREEN_ALL)
+//
+// Outputs:     TRUE  if the command was found
+//              FALSE if not, or not for those screens
+//
+static bool FindCommand(const char *Name,COMMAND_DEF *Def,uint8_t Screen) {
+    uint8_t Lo     = 0;
+    uint8_t Hi     = NUMOF(Commands);
 
-#ifdef USE_HELP_SCREEN
     //
-    // HE - Help screen
+    // Find the first entry with the name, or where it would be
     //
-    if( StrEQ(Command,"HE") ||
-        StrEQ(Command,"?" ) ) {
-        ShowScreen('HE');
-        return;
+    while( Lo < Hi ) {
+        uint8_t Mid = (Lo + Hi)/2;
+
+        if( strcmp_P(Name,Commands[Mid].Name) > 0 ) Lo = Mid + 1;
+        else                                        Hi = Mid;
         }
 
-#ifdef USE_HELP_SCREEN_CMDS
     //
-    // See if the local screen can manage the command
+    // Then the first of those for the screens
     //
-    if( SelectedScreen == 'HE' ) {
-        if( HEScreenCommand(Command) )
-            return;
+    for( ; Lo < NUMOF(Commands); Lo++ ) {
+        memcpy_P(Def,&Commands[Lo],sizeof(*Def));
+
+        if( strcmp(Name,Def->Name) != 0 )
+            break;
+
+        if( Def->Screens & Screen )
+            return true;
         }
-#endif
-#endif
 
+    return false;
+    }
+
+//////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
+//
+// CommandKnown - Return TRUE if a name is in the command table, for any screen
+//
+// Inputs:      Command name, in upper case
+//
+// Outputs:     TRUE  if the name is a command
+//              FALSE otherwise
+//
+bool CommandKnown(const char *Name) {
+    COMMAND_DEF Def;
 
-#ifdef USE_DEBUG_SCREEN
-    //
-    // DE - Show the debug screen
-    //
-    if( StrEQ(Command,"DE") ) {
-        ShowScreen('DE');
-        return;
+    return strlen(Name) < sizeof(Def.Name) && FindCommand(Name,&Def,SCREEN_ALL);
+    }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// CommandArg - Convert and range check a number argument
+//
+// Inputs:      Argument text
+//              Unit of the number (UNIT_xx)
+//              Smallest and largest allowed values, in internal units
+//              Where to put the number
+//
+// Outputs:     TRUE  if the argument is good
+//              FALSE if not, and the error has been printed
+//
+// The range is printed in the unit the user is most likely to type.
+//
+bool CommandArg(const char *Text,UNIT Unit,uint16_t Min,uint16_t Max,uint16_t *Value) {
+    uint16_t Num;
+
+    if( ParseValue(Text,Unit,&Num) && Num >= Min && Num <= Max ) {
+        *Value = Num;
+        return true;
         }
 
-#ifdef USE_DEBUG_SCREEN_CMDS
-    //
-    // See if the local screen can manage the command
-    //
-    if( SelectedScreen == 'DE' ) {
-        if( DEScreenCommand(Command) )
-            return;
+    CursorPos(1,ERROR_ROW);
+    ClearEOL;
+    PrintStringP(PSTR("Bad or out of range number ("));
+    PrintString(Text);
+
+    switch( Unit ) {
+        case UNIT_HZ:    PrintF("), must be %u to %u Hz\r\n" BEEP,Min,Max); break;
+        case UNIT_POWER: PrintF("), must be %.1uW to %.1uW\r\n" BEEP,Min,Max); break;
+        case UNIT_TICKS: PrintF("), must be %u to %u ticks\r\n" BEEP,Min,Max); break;
+        default:         PrintF("), must be %u to %u\r\n" BEEP,Min,Max); break;
         }
-#endif
-#endif
+    return false;
+    }
 
 //////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// CommandHelp - Print the help line of a command
+//
+// Inputs:      Command table index to start from
+//
+// Outputs:     Index just past the command printed, or 0 if there are no more
+//
+// Commands without help are skipped. The line is printed where the cursor is.
+//
+uint8_t CommandHelp(uint8_t Index) {
 
-#ifdef USE_MEMORY_SCREEN
-    //
-    // ME - Show the memory screen
-    //
-    if( StrEQ(Command,"ME") ) {
-        ShowScreen('ME');
+    for( ; Index < NUMOF(Commands); Index++ ) {
+        PGM_P Help = (PGM_P) pgm_read_word(&Commands[Index].Help);
+
+        if( Help ) {
+            PrintF("%-4s%s",Commands[Index].Name,Help);
+            return Index + 1;
+            }
+        }
+
+    return 0;
+    }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command - Process text command
+//
+// Inputs:      Line command to process
+//
+// Outputs:     None.
+//
+// The line is split into tokens in place, and the name is upper cased in place, then
+//   looked up in the command table. A number argument is checked against the range in
+//   the table, and stored, before the handler is called.
+//
+// A name not in the table may be a macro (see Macro.h). Commands in a macro are found
+//   whatever screen is showing.
+//
+void Command(char *Buffer) {
+    COMMAND_DEF Def;
+    char       *End     = Buffer + strlen(Buffer);
+    char       *Argv[MAX_ARGS];
+    uint8_t     Argc    = ParseArgs(Buffer,Argv,NUMOF(Argv));
+    char       *Command = Argv[0];
+    uint8_t     Len;
+
+    for( Len = 0; Command[Len]; Len++ )
+        Command[Len] = toupper(Command[Len]);
+
+    if( Len < sizeof(Def.Name) &&
+        FindCommand(Command,&Def,MacroRunning ? SCREEN_ALL : ScreenMask()) ) {
+
+        //
+        // Text: put the delimiters back after the first argument, so the rest of the
+        //   line is all in Argv[2], however many tokens it has
+        //
+        if( Def.Arg == ARG_TEXT ) {
+            for( char *Text = Argv[2]; Text < End; Text++ )
+                if( *Text == 0 )
+                    *Text = ' ';
+            }
+        else if( Argc > NUMOF(Argv) ) {
+            CursorPos(1,ERROR_ROW);
+            ClearEOL;
+            PrintStringP(PSTR("Too many arguments (" __xstr__(MAX_ARGS) " at most)\r\n" BEEP));
+            return;
+            }
+
+        if( Def.Arg == ARG_NUM || (Def.Arg == ARG_OPT && Argv[1][0]) ) {
+            uint16_t Value;
+
+            if( !CommandArg(Argv[1],Def.Unit,Def.Min,Def.Max,&Value) )
+                return;
+
+            if( Def.Var )
+                *(uint16_t *) SG3525EditVar(Def.Var) = Value;
+            }
+
+        if( Def.Fn )
+            Def.Fn(Argc,Argv);
         return;
         }
 
-#ifdef USE_MEMORY_SCREEN_CMDS
+    if( MacroRun(Command) )
+        return;
+
     //
     // See if the local screen can manage the command
     //
-    if( SelectedScreen == 'ME' ) {
-        if( MEScreenCommand(Command) )
-            return;
-        }
+#ifdef USE_HELP_SCREEN_CMDS
+    if( SelectedScreen == 'HE' && HEScreenCommand(Command) )
+        return;
 #endif
+
+#ifdef USE_DEBUG_SCREEN_CMDS
+    if( SelectedScreen == 'DE' && DEScreenCommand(Command) )
+        return;
 #endif
 
-#ifdef USE_EEPROM_SCREEN
-    //
-    // EE - Show the memory screen
-    //
-    if( StrEQ(Command,"EE") ) {
-        ShowScreen('EE');
+#ifdef USE_MEMORY_SCREEN_CMDS
+    if( SelectedScreen == 'ME' && MEScreenCommand(Command) )
         return;
-        }
+#endif
 
 #ifdef USE_EEPROM_SCREEN_CMDS
-    //
-    // See if the local screen can manage the command
-    //
-    if( SelectedScreen == 'EE' ) {
-        if( EEScreenCommand(Command) )
-            return;
-        }
-#endif
+    if( SelectedScreen == 'EE' && EEScreenCommand(Command) )
+        return;
 #endif
 
     //
@@ -310,6 +653,35 @@ void Command(char *Buffer) {
     PrintStringP(PSTR(BEEP));
     }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// CommandLine - Process a line of commands, separated by CMD_SEPARATOR
+//
+// Inputs:      Line of commands to process (changed by the parse)
+//
+// Outputs:     None.
+//
+// Each command is cut off at the next separator, in place, and processed as if it
+//   were on a line by itself. MD is not cut off: the macro it defines takes the rest
+//   of the line, separators and all.
+//
+void CommandLine(char *Line) {
+    char *Next;
+
+    do {
+        while( IsDelimiter(*Line) )
+            Line++;
+
+        Next = StrEQ(Line,"MD") ? NULL : strchr(Line,CMD_SEPARATOR);
+        if( Next )
+            *Next++ = 0;
+
+        Command(Line);
+        Line = Next;
+        } while( Line );
+    }
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -326,6 +698,24 @@ void Prompt(void) {
     PrintString(PROMPT);
     }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PlotCommand - Print out the prompt, and the command typed so far
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+// For when the input line may have been drawn over, such as by a new screen.
+//
+void PlotCommand(void) {
+
+    Prompt();
+    PrintString(CommandBuffer);
+    CursorMark;
+    }
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -335,15 +725,36 @@ void Prompt(void) {
 //
 // Outputs:     None.
 //
+// The row is fixed, so only the column is converted at run time.
+//
 void PlotInput(void) {
 
-    PrintStringP(PSTR("\033["));
-    PrintD(INPUT_ROW,0);
-    PrintStringP(PSTR(";"));
-    PrintD(INPUT_COL+strlen(CommandBuffer)+strlen(PROMPT),0);
+    PrintStringP(PSTR("\033[" __xstr__(INPUT_ROW) ";"));
+    PrintD(INPUT_COL+nChars+sizeof(PROMPT)-1,0);
     PrintStringP(PSTR("H"));
     }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// EchoInput - Echo input chars at the input position
+//
+// Inputs:      Chars to echo
+//
+// Outputs:     None.
+//
+// The cursor is left just past the echo, which is where the next char goes. So unless
+//   other output went out in between (a reply, a screen refresh record, telemetry),
+//   the next echo needs no positioning: one byte per keystroke instead of nine.
+//
+static void EchoInput(const char *Echo) {
+
+    if( CursorMoved )
+        PlotInput();
+    PrintString(Echo);
+    CursorMark;
+    }
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -367,7 +778,7 @@ void PlotError(char *Error) {
 // ProcessSerialInput - Parse serial command input chars
 //
 // Collect chars until a terminator is seen, then pass the input 
-//   buffer to SystemCommand().
+//   buffer to CommandLine().
 //
 // Inputs:      Serial input char to process
 //
@@ -395,13 +806,13 @@ void ProcessSerialInput(char InChar) {
     //
     if( InChar == BACKSPACE ) {
         if( nChars != 0 ) {        // If not at start of command
-            PlotInput();
-            CommandBuffer[--nChars] = 0;
             TempOutLine[0] = BACKSPACE;
             TempOutLine[1] = ' ';
             TempOutLine[2] = BACKSPACE;
             TempOutLine[3] = 0;
-            PrintString(TempOutLine);
+            if( !QueryMode )
+                EchoInput(TempOutLine);
+            CommandBuffer[--nChars] = 0;
             }
         return;
         }
@@ -420,8 +831,21 @@ void ProcessSerialInput(char InChar) {
         }
     else TempOutLine[0] = 0;
 
-    PlotInput();
-    PrintString(TempOutLine);
+    if( !QueryMode )
+        EchoInput(TempOutLine);
+
+    //
+    // In machine mode the host's line goes to QueryLine() instead, ended by CR or LF.
+    //   ESC just drops the line.
+    //
+    if( QueryMode && (InChar == '\r' || InChar == '\n' || InChar == ESC) ) {
+        if( InChar != ESC )
+            QueryLine(CommandBuffer);
+        InitCommandBuffer();
+        if( !QueryMode )
+            PlotCommand();
+        return;
+        }
 
     //
     // In the lingo of the system, a '\r' indicates EOL
@@ -435,9 +859,9 @@ void ProcessSerialInput(char InChar) {
         if( InChar == ESC ) 
             strcpy(CommandBuffer,ESC_CMD);
 
-        Command(CommandBuffer);
+        CommandLine(CommandBuffer);
         InitCommandBuffer();
-        Prompt();
+        PlotCommand();
         return;
         }
     else if (InChar == '\n')               // Do not add \n characters to
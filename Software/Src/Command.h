@@ -69,8 +69,11 @@
 #ifndef COMMAND_H
 #define COMMAND_H
 
+#include <stdint.h>
 #include <stdbool.h>
 
+#include "Parse.h"
+
 //
 // The user input prompt
 //
@@ -79,17 +82,17 @@
 #endif
 
 //
-// Maximum size of an input token. In other words, the maximum number of characters in 
-//   a command, or between two delimiters or the maximum number of digits in an
-//   input number
+// Maximum number of tokens in a command line, including the command itself. Tokens
+//   may be any length.
 //
-#define MAX_TOKEN_LENGTH    10
+#define MAX_ARGS            6
 
 //
 // Maximum size of an input entry.  In other words, the maximum number of characters
-//   that can be entered on a single line for input over the serial port.
+//   that can be entered on a single line for input over the serial port. Room for a
+//   few commands, separated by CMD_SEPARATOR.
 //
-#define MAX_CMD_LENGTH      20
+#define MAX_CMD_LENGTH      40
 
 //
 // Any character in the following is a delimiter character. Delimiters come between
@@ -97,6 +100,11 @@
 //
 #define DELIMITERS  " \t"
 
+//
+// Separates commands on one line, as "FR 28500;PO 255;ON"
+//
+#define CMD_SEPARATOR   ';'
+
 //
 // Define this next def and serial input will be echoed back to the user
 //   (Debugging thingy.)
@@ -105,6 +113,12 @@
 
 #define ESC_CMD "\033"
 
+//
+// A command handler, called with the tokens of the command line. Argv[0] is the
+//   command name in upper case, and Argv[] entries past the last token are "".
+//
+typedef void (*COMMAND_FN)(uint8_t Argc,char *Argv[]);
+
 //
 // End of user configurable options
 //
@@ -132,6 +146,35 @@ void CommandInit(void);
 //
 bool StrEQ(const char *String1, const char *String2);
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// CommandArg - Convert and range check a number argument
+//
+// Inputs:      Argument text
+//              Unit of the number (UNIT_xx, see Parse.h)
+//              Smallest and largest allowed values, in internal units
+//              Where to put the number
+//
+// Outputs:     TRUE  if the argument is good
+//              FALSE if not, and the error has been printed
+//
+// Number arguments in the command table are checked before the handler is called.
+//   This is for arguments the table can't describe, such as "MO RT #".
+//
+bool CommandArg(const char *Text,UNIT Unit,uint16_t Min,uint16_t Max,uint16_t *Value);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// CommandHelp - Print the help line of a command
+//
+// Inputs:      Command table index to start from
+//
+// Outputs:     Index just past the command printed, or 0 if there are no more
+//
+uint8_t CommandHelp(uint8_t Index);
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -154,6 +197,17 @@ void Prompt(void);
 //
 void PlotInput(void);
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PlotCommand - Print out the prompt, and the command typed so far
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void PlotCommand(void);
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -171,7 +225,7 @@ void PlotError(char *Error);
 // ProcessSerialInput - Parse serial command input chars
 //
 // Collect chars until a terminator is seen, then pass the input 
-//   buffer to SystemCommand().
+//   buffer to CommandLine().
 //
 // Inputs:      Serial input char to process
 //
@@ -190,4 +244,29 @@ void ProcessSerialInput(char InChar);
 //
 void Command(char *Buffer);
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// CommandKnown - Return TRUE if a name is in the command table, for any screen
+//
+// Inputs:      Command name, in upper case
+//
+// Outputs:     TRUE  if the name is a command
+//              FALSE otherwise
+//
+bool CommandKnown(const char *Name);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// CommandLine - Process a line of commands, separated by CMD_SEPARATOR
+//
+// Inputs:      Line of commands to process (changed by the parse)
+//
+// Outputs:     None.
+//
+// The commands are run in order, all in the same main loop pass.
+//
+void CommandLine(char *Line);
+
 #endif  // COMMAND_H - entire file
@@ -42,16 +42,29 @@
 
 #include "DEScreen.h"
 #include "Serial.h"
+#include "Format.h"
 #include "Command.h"
 #include "VT100.h"
 #include "Debug.h"
 #include "Dump.h"
+#include "UART.h"
+#include "SerialLong.h"
 
 #define FREE_ROW    16
+#define SERIAL_ROW  23
+#define UART_ROW    24
 
-#ifndef USE_DEBUG_ARRAY
+#ifdef USE_DEBUG_ARRAY
+#define DUMP_START  ((uint16_t) DebugArray)
+#define DUMP_END    (DUMP_START + sizeof(DebugArray))
+#define DUMP        DumpMem
+#else
 static  int StartDump =    0;
 static  int EndDump   = 0x90;
+
+#define DUMP_START  ((uint16_t) StartDump)
+#define DUMP_END    ((uint16_t) EndDump + 0x10)
+#define DUMP        DumpEEPROM
 #endif
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -59,38 +72,61 @@ static  int EndDump   = 0x90;
 //
 // ShowDEScreen - Display the debug screen
 //
-// Inputs:      None.
+// Inputs:      Step of the drawing, starting from 0
 //
-// Outputs:     None.
+// Outputs:     TRUE  if more steps follow
+//              FALSE if the screen is drawn
 //
-void ShowDEScreen(void) {
+// The heading is step 0, then each step dumps one line of 16 bytes.
+//
+bool ShowDEScreen(uint8_t Step) {
 
-    CursorHome;
-    ClearScreen;
+    if( Step == 0 ) {
+        CursorHome;
+        ClearScreen;
 
 #ifdef USE_DEBUG_ARRAY
 
-    PrintStringP(PSTR("DebugArray[0..0x"));
-    PrintH2(DEBUG_SIZE);
-    PrintStringP(PSTR("]:\r\n"));
-
-    DumpMem((uint8_t *) DebugArray,DEBUG_SIZE);
+        PrintStringP(PSTR("DebugArray[0..0x"));
+        PrintH2(DEBUG_SIZE);
+        PrintStringP(PSTR("], oldest at [0x"));
+        PrintH2(DebugIndex);
+        PrintStringP(PSTR("]:\r\n\r\n"));
 
 #else
 
-    PrintStringP(PSTR("0x"));
-    PrintH2(E2END+1);
-    PrintStringP(PSTR(" bytes EEPROM[0x"));
-    PrintH2(StartDump);
-    PrintStringP(PSTR("-0x"));
-    PrintH2(EndDump);
-    PrintStringP(PSTR("]:\r\n"));
-
-    DumpEEPROM((uint8_t *) StartDump,EndDump - StartDump + 0x10);
+        PrintStringP(PSTR("0x"));
+        PrintH2(E2END+1);
+        PrintStringP(PSTR(" bytes EEPROM[0x"));
+        PrintH2(StartDump);
+        PrintStringP(PSTR("-0x"));
+        PrintH2(EndDump);
+        PrintStringP(PSTR("]:\r\n\r\n"));
 
 #endif
+        return true;
+        }
+
+    //
+    // The first line starts wherever the dump does, the rest on 16 byte boundaries
+    //
+    uint16_t Addr = DUMP_START;
+
+    if( Step > 1 )
+        Addr = (Addr & ~0x0F) + ((Step-1) << 4);
+
+    if( Addr < DUMP_END ) {
+        uint16_t Len = 0x10 - (Addr & 0x0F);
+
+        if( Len > DUMP_END - Addr )
+            Len = DUMP_END - Addr;
+
+        DUMP((uint8_t *) Addr,Len);
+        return true;
+        }
 
     UpdateDEScreen();
+    return false;
     }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -109,6 +145,13 @@ void UpdateDEScreen(void) {
     CursorPos(1,FREE_ROW);
     DebugPrint();
 
+    PrintF(CURSOR_AT(1,SERIAL_ROW) "Serial deferred %5u dropped %5u lost %5u",
+           SerialStats.Deferred,SerialStats.Dropped,SerialStats.Lost);
+
+    PrintF(CURSOR_AT(1,UART_ROW) "UART framing %5u overrun %5u full %5u baud %7lu%s",
+           UARTStats.Framing,UARTStats.Overrun,UARTStats.Full,UARTGetBaud(),
+           UARTGetFlow() ? PSTR(" XON") : PSTR("    "));
+
     //
     //
     //
@@ -49,11 +49,12 @@
 //
 // ShowDEScreen - Show debug status screen
 //
-// Inputs:      None
+// Inputs:      Step of the drawing, starting from 0
 //
-// Outputs:     None.
+// Outputs:     TRUE  if more steps follow
+//              FALSE if the screen is drawn
 //
-void ShowDEScreen(void);
+bool ShowDEScreen(uint8_t Step);
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -73,7 +74,7 @@ bool DEScreenCommand(char *Command);
 
 #else   // USE_DESCREEN
 
-#define ShowDEScreen()
+#define ShowDEScreen(_s_)  false
 #define UpdateDEScreen()
 
 #endif  // USE_DESCREEN
@@ -60,8 +60,11 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
+#include <string.h>
+
 #include "Debug.h"
 #include "Serial.h"
+#include "Format.h"
 #include "PortMacros.h"
 
 #ifdef DEBUG_CPU_COUNT
@@ -72,22 +75,9 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 #ifdef USE_DEBUG_ARRAY
-//
-// The GCC compiler ignores "__attribute__ ((aligned (8)))", so use the assembler
-//   macros to achieve 16-byte alignment. (GCC bug)
-//
-//uint16_t DebugArray[DEBUG_SIZE] __attribute__ ((aligned (8)));
-//
-asm("           .global DebugArray");
-asm("           .data             ");
-asm("           .align           8");   // 8 words, 16bytes
-asm("DebugArray:.byte          128");   // **** MUST MATCH DEBUG_ARRAY!!! ****
-asm("           .text             ");
-
-       uint16_t DebugIndex    NOINIT;   // Wraparound index into DebugArray
-static uint8_t  DebugTrigFlag NOINIT;   // Trigger flag
-
-#define DEBUG_WRAP  (DEBUG_SIZE-1)      // Wraparound mask for DebugIndex
+       uint16_t DebugArray[DEBUG_SIZE] NOINIT;  // Logged values, wrapping around
+       uint8_t  DebugIndex             NOINIT;  // Where the next value goes (the oldest)
+static uint8_t  DebugTrigFlag          NOINIT;  // Trigger flag
 #endif
 
 #ifdef DEBUG_CPU_COUNT
@@ -116,10 +106,9 @@ void DebugInit(void) {
     Debug4 = 0;
 
 #ifdef USE_DEBUG_ARRAY
-    for( DebugIndex = 0; DebugIndex < DEBUG_SIZE; DebugIndex ++ )
-        DebugArray[DebugIndex] = 0;
+    memset(DebugArray,0,sizeof(DebugArray));
+    DebugIndex    = 0;
 
-    DebugIndex    = 0;
     DebugTrigFlag = DEBUG_TRIG_SET;
 #endif
 
@@ -139,13 +128,13 @@ void DebugInit(void) {
 //
 void DebugPrint(void) {
 
-    PrintStringP(PSTR("DBG1 "));PrintD(Debug1,-6);PrintCRLF();
-    PrintStringP(PSTR("DBG2 "));PrintD(Debug2,-6);PrintCRLF();
-    PrintStringP(PSTR("DBG3 "));PrintD(Debug3,-6);PrintCRLF();
-    PrintStringP(PSTR("DBG4 "));PrintD(Debug4,-6);PrintCRLF();
+    PrintF("DBG1 %-6u\r\n"
+           "DBG2 %-6u\r\n"
+           "DBG3 %-6u\r\n"
+           "DBG4 %-6u\r\n",Debug1,Debug2,Debug3,Debug4);
 
 #ifdef DEBUG_CPU_COUNT
-    PrintStringP(PSTR("CNTR "));PrintLD(DebugCPUCounter,8);PrintCRLF();
+    PrintF("CNTR %8lu\r\n",DebugCPUCounter);
     DebugCPUCounter = 0;
 #endif  // DEBUG_CPU_COUNT
     }
@@ -176,10 +165,11 @@ void DebugLog(uint16_t Value) {
         return;
 
     //
-    // Log values
+    // Log values, writing over the oldest. This is a trace rather than a queue
+    //   (nothing takes values out), so it isn't a ring.
     //
-    DebugArray[DebugIndex] = Value;
-    DebugIndex = (DebugIndex+1) & DEBUG_WRAP;
+    DebugArray[DebugIndex] = Value;
+    DebugIndex = (DebugIndex+1) & (DEBUG_SIZE-1);
 
     //
     // Wind down to DEBUG_STOP if triggered
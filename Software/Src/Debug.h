@@ -87,12 +87,11 @@ extern uint16_t Debug4;
 #define USE_DEBUG_ARRAY
 
 //
-// Size of debug array.
+// Size of debug array, in values.
 //
-// NOTE1: Must be a power of 2
-// NOTE2: Due to GCC bug, must also be set in Debug.c
+// NOTE: Must be a power of 2, max 256
 //
-#define DEBUG_SIZE  0x80                // Power of 2, and match definition in Debug.c
+#define DEBUG_SIZE  0x40                // == 128 bytes
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -107,7 +106,7 @@ extern uint16_t Debug4;
 //////////////////////////////////////////////////////////////////////////////////////////
 
 #ifdef USE_DEBUG_ARRAY
-extern uint16_t DebugIndex;
+extern uint8_t  DebugIndex;
 extern uint16_t DebugArray[DEBUG_SIZE];
 
 #define DEBUG_TRIG_SET      -1
@@ -37,95 +37,118 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
+#include <stdbool.h>
+
 #include <avr/pgmspace.h>
 #include <avr/eeprom.h>
 
 #include "Dump.h"
 #include "Serial.h"
 
+//
+// One line of dump: "AAAA: ", 16 x "HH ", and CR/LF
+//
+#define DUMP_LINE   (2+6+16*3)
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// DumpSpaces - Print out spaces for a block memory dump
+// DumpHex - Put hex byte into dump line
 //
-// Inputs:      Address to start dumping
-//              # of bytes per line to dump
+// Inputs:      Where to put the chars
+//              Byte to convert
 //
-// Outputs:     None.
+// Outputs:     Next char in dump line
 //
-static void DumpSpaces(uint8_t *Addr,uint8_t NumData) {
-    uint8_t Spaces = (((uint16_t) Addr) & (NumData-1));
+static char *DumpHex(char *Out,uint8_t Byte) {
+    uint8_t Nibble;
 
-    //
-    // Print out spaces so that corresponding bytes will match first line
-    //
-    if( Spaces != 0 ) {
-        PrintH(((uint16_t) Addr) >> 8);
-        PrintH(((uint16_t) Addr) & 0xFF);
-        PrintStringP(PSTR(": "));
-        while( Spaces-- )
-            PrintStringP(PSTR("   "));
-        }
+    Nibble = Byte >> 4;   *Out++ = Nibble < 10 ? '0' + Nibble : 'A' - 10 + Nibble;
+    Nibble = Byte & 0x0F; *Out++ = Nibble < 10 ? '0' + Nibble : 'A' - 10 + Nibble;
+    return Out;
     }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// DumpMem - Dump out a block of memory
+// DumpAddr - Put "AAAA: " address into dump line
+//
+// Inputs:      Where to put the chars
+//              Address to convert
+//
+// Outputs:     Next char in dump line
+//
+static char *DumpAddr(char *Out,uint8_t *Addr) {
+
+    Out    = DumpHex(Out,((uint16_t) Addr) >> 8);
+    Out    = DumpHex(Out,((uint16_t) Addr) & 0xFF);
+    *Out++ = ':';
+    *Out++ = ' ';
+    return Out;
+    }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// DumpBlock - Dump out a block of memory or EEPROM
+//
+// Each line is built in a buffer and printed as one block, ending with CR/LF. Lines
+//   break at every 16 byte boundary, so a block that fits within one 16 byte row
+//   prints exactly one line.
 //
 // Inputs:      Address to start dumping
-//              # of bytes to dump
+//              Number of bytes to dump
+//              TRUE if address is in EEPROM
 //
 // Outputs:     None.
 //
-void DumpMem(uint8_t *Addr,uint16_t Len) {
+static void DumpBlock(uint8_t *Addr,uint16_t Len,bool EEPROM) {
+    char     Line[DUMP_LINE];
 
-    DumpSpaces(Addr,16);
+    while( Len ) {
+        char    *Out    = DumpAddr(Line,Addr);
+        uint8_t  Spaces = ((uint16_t) Addr) & 0x0F;
 
-    while( Len-- ) {
         //
-        // Every 16 bytes print out a CR and current address
+        // Print out spaces so that corresponding bytes will match first line
         //
-        if( (((uint16_t) Addr) & 0x0F) == 0 ) {
-            PrintCRLF();
-            PrintH(((uint16_t) Addr) >> 8);
-            PrintH(((uint16_t) Addr) & 0xFF);
-            PrintStringP(PSTR(": "));
+        while( Spaces-- ) {
+            *Out++ = ' ';
+            *Out++ = ' ';
+            *Out++ = ' ';
             }
-        PrintH(*Addr++);
-        PrintChar(' ');
-        }
 
-    PrintCRLF();
+        do {
+            Out    = DumpHex(Out,EEPROM ? eeprom_read_byte(Addr) : *Addr);
+            *Out++ = ' ';
+            Addr++;
+            Len--;
+            } while( Len && (((uint16_t) Addr) & 0x0F) );
+
+        *Out++ = '\r';
+        *Out++ = '\n';
+        PrintBlock(Line,Out-Line);
+        }
     }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// DumpEEPROM - Dump out a block of EEPROM
+// DumpMem - Dump out a block of memory
 //
 // Inputs:      Address to start dumping
-//              # of bytes to dump
 //
 // Outputs:     None.
 //
-void DumpEEPROM(uint8_t *Addr,uint16_t Len) {
-
-    DumpSpaces(Addr,16);
-
-    while( Len-- ) {
-        //
-        // Every 16 bytes print out a CR and current address
-        //
-        if( (((uint16_t) Addr) & 0x0F) == 0 ) {
-            PrintCRLF();
-            PrintH(((uint16_t) Addr) >> 8);
-            PrintH(((uint16_t) Addr) & 0xFF);
-            PrintStringP(PSTR(": "));
-            }
-        PrintH(eeprom_read_byte(Addr++));
-        PrintChar(' ');
-        }
+void DumpMem(uint8_t *Addr,uint16_t Len) { DumpBlock(Addr,Len,false); }
 
-    PrintCRLF();
-    }
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// DumpEEPROM - Dump out a block of EEPROM
+//
+// Inputs:      Address to start dumping
+//
+// Outputs:     None.
+//
+void DumpEEPROM(uint8_t *Addr,uint16_t Len) { DumpBlock(Addr,Len,true); }
@@ -75,7 +75,28 @@ void EEPROMInit(void) {
 //
 // Outputs:     None.
 //
+// NOTE: Only bytes that have changed are written, which saves time and EEPROM wear
+//         when small values (such as the ACS712 zero) are updated.
+//
 void EEPROMWrite(void) {
 
-    eeprom_write_block(&EEPROM,0,sizeof(EEPROM));
+    eeprom_update_block(&EEPROM,0,sizeof(EEPROM));
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// EEPROMWritePart - Write part of the EEPROM copy from RAM
+//
+// Inputs:      Ptr to part of the RAM copy (EEPROM.x)
+//              Size of the part, in bytes
+//
+// Outputs:     None.
+//
+// Use EEPROMWriteField(), which fills in the size.
+//
+void EEPROMWritePart(const void *Part,uint16_t Size) {
+
+    eeprom_update_block(Part,(void *)((const uint8_t *) Part - (uint8_t *) &EEPROM),Size);
     }
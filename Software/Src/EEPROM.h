@@ -64,13 +64,17 @@
 #include <stdint.h>
 
 #include "Setup.h"
+#include "Fault.h"
+#include "ACS712.h"
+#include "Thermal.h"
+#include "Macro.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 // EEPROM memory layout
 //
-#define EEPROM_CURR_VERSION 6
+#define EEPROM_CURR_VERSION 12
 
 typedef struct {
     //
@@ -83,6 +87,14 @@ typedef struct {
     // User defined vars go here
     //
     SETUP       Setups[MAX_SETUPS];
+
+    FAULT_ACTION FaultActions[NUM_FAULTS];      // What to do when a fault is latched
+
+    ACS712_CAL  ACS712Cal;                      // Current sensor zero and gain
+
+    THERMAL_CAL ThermalCal;                     // Temperature sensor offset
+
+    MACRO       Macros[MAX_MACROS];             // Named command lines
 
     //////////////////////////////////////////////////////////////////////////////////////
     } EEPROM_T;
@@ -119,4 +131,20 @@ void EEPROMInit(void);
 void EEPROMWrite(void);
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// EEPROMWriteField - Write one field of the EEPROM copy, and nothing else
+//
+// Inputs:      Field of EEPROM to write, such as EEPROM.ACS712Cal
+//
+// Outputs:     None.
+//
+// Other unsaved changes in RAM (such as FA edits) are left for "SS" to save.
+//
+#define EEPROMWriteField(_Field_)   EEPROMWritePart(&(_Field_),sizeof(_Field_))
+
+void EEPROMWritePart(const void *Part,uint16_t Size);
+
+
 #endif  // EEPROM_H - entire file
@@ -0,0 +1,495 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Fault.c - Transducer fault diagnostics
+//
+//  SYNOPSIS
+//
+//      See Fault.h for details
+//
+//  DESCRIPTION
+//
+//      Classify, latch, and act on transducer faults
+//
+//  VERSION:    2015.08.20
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "Fault.h"
+#include "SG3525.h"
+#include "Supply.h"
+#include "Thermal.h"
+#include "EEPROM.h"
+
+#include "Command.h"
+#include "Parse.h"
+#include "Serial.h"
+#include "MAScreen.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data declarations
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+static struct {
+    uint8_t     Latched;                            // Mask of latched faults
+    uint8_t     Settle;                             // Ticks until checks start
+    uint8_t     OpenCount;                          // Consecutive ticks of each condition
+    uint8_t     ShortCount;
+    uint8_t     RailCount;
+    uint8_t     LockCount;
+    uint8_t     BrownoutCount;
+    uint8_t     OvertempCount;
+    uint16_t    DerateWiper;                        // PWM wiper limit when derating
+#ifdef USE_FAULT_INJECT
+    FAULT_CODE  Inject;                             // Injected fault scenario
+    uint8_t     InjectTicks;                        // Ticks left in scenario
+#endif
+    } Fault NOINIT;
+
+const FAULT_ACTION FaultDefaults[NUM_FAULTS] PROGMEM = {
+    FAULT_STOP,                                     // Open
+    FAULT_STOP,                                     // Short
+    FAULT_WARN,                                     // Lock
+    FAULT_STOP,                                     // Brownout
+    FAULT_STOP,                                     // Overtemp
+    };
+
+//
+// Per the WINAVR definition of PROGMEM, we must explicitly put each string into PROGMEM
+//   within an array separately
+//
+static char FNT0[] PROGMEM = "None ";
+static char FNT1[] PROGMEM = "Open ";
+static char FNT2[] PROGMEM = "Short";
+static char FNT3[] PROGMEM = "Lock ";
+static char FNT4[] PROGMEM = "Brown";
+static char FNT5[] PROGMEM = "Hot  ";
+
+static char *FaultNameText[NUM_FAULTS+1] = {
+    FNT0, FNT1, FNT2, FNT3, FNT4, FNT5
+    };
+
+static char FAT1[] PROGMEM = "warn";
+static char FAT2[] PROGMEM = "derate";
+static char FAT3[] PROGMEM = "stop";
+
+static char *FaultActionText[NUM_FAULT_ACTIONS] = {
+    FAT1, FAT2, FAT3
+    };
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultInit - Initialize fault diagnostics
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void FaultInit(void) {
+
+    memset(&Fault,0,sizeof(Fault));
+
+    Fault.Settle      = FAULT_SETTLE_TICKS;
+    Fault.DerateWiper = PWMPot_MAX_WIPER;
+#ifdef USE_FAULT_INJECT
+    Fault.Inject      = FAULT_NONE;
+#endif
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultClear - Clear all latched faults
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void FaultClear(void) { FaultInit(); }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultGet - Return the first latched fault
+//
+// Inputs:      None.
+//
+// Outputs:     Fault code, FAULT_NONE if no fault latched
+//
+FAULT_CODE FaultGet(void) {
+
+    for( uint8_t i = 0; i < NUM_FAULTS; i++ ) {
+        if( Fault.Latched & (1 << i) )
+            return FAULT_OPEN + i;
+        }
+
+    return FAULT_NONE;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultAction - Return configured action for fault
+//
+// Inputs:      Fault code
+//
+// Outputs:     Action to take when fault is latched
+//
+static FAULT_ACTION FaultAction(FAULT_CODE Code) {
+    return EEPROM.FaultActions[IDX_FAULT(Code)];
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultStopped - Return TRUE if a fault with action FAULT_STOP is latched
+//
+// Inputs:      None.
+//
+// Outputs:     TRUE if output is being held off by a fault
+//
+bool FaultStopped(void) {
+
+    for( uint8_t i = 0; i < NUM_FAULTS; i++ ) {
+        if( (Fault.Latched & (1 << i)) &&
+            FaultAction(FAULT_OPEN + i) == FAULT_STOP )
+            return true;
+        }
+
+    return false;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultName - Return printable name of fault
+//
+// Inputs:      Fault code
+//
+// Outputs:     PROGMEM string, 5 chars wide
+//
+PGM_P FaultName(FAULT_CODE Code) { return FaultNameText[Code - FAULT_NONE]; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultCount - Count consecutive ticks of a fault condition
+//
+// Inputs:      Ptr to condition counter
+//              TRUE if fault condition is present this tick
+//              Number of consecutive ticks needed to latch
+//
+// Outputs:     TRUE  if condition has lasted long enough to latch
+//              FALSE otherwise
+//
+static bool FaultCount(uint8_t *Count,bool Condition,uint8_t Limit) {
+
+    if( !Condition ) {
+        *Count = 0;
+        return false;
+        }
+
+    if( *Count < Limit )
+        (*Count)++;
+
+    return *Count >= Limit;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultLatch - Latch a fault, and report it
+//
+// Inputs:      Fault code to latch
+//
+// Outputs:     None.
+//
+static void FaultLatch(FAULT_CODE Code) {
+    FAULT_ACTION Action = FaultAction(Code);
+
+    if( Fault.Latched & FAULT_MASK(Code) )
+        return;
+
+    Fault.Latched |= FAULT_MASK(Code);
+
+    if( Action == FAULT_DERATE ) {
+        uint16_t Derate = SG3525Curr.PWMWiper/2;
+        if( Derate < Fault.DerateWiper )
+            Fault.DerateWiper = Derate;
+        }
+
+    StartMsg();
+    PrintStringP(PSTR("Fault "));
+    PrintD(Code,0);
+    PrintStringP(PSTR(": "));
+    PrintStringP(FaultName(Code));
+    PrintStringP(PSTR(" ("));
+    PrintStringP(FaultActionText[IDX_FAULT_ACTION(Action)]);
+    PrintStringP(PSTR(")\r\n"));
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultUpdate - Check for faults, and apply actions of latched faults
+//
+// Inputs:      None. (Called every tick, after SG3525Curr has been updated)
+//
+// Outputs:     None.
+//
+void FaultUpdate(void) {
+    uint16_t    Current = SG3525Curr.Current;
+    uint16_t    PWM     = SG3525Curr.PWM;
+    uint16_t    Freq    = SG3525Curr.Freq;
+    uint16_t    Vcc     = SG3525Curr.Vcc;
+    int16_t     Temp    = ThermalGetTemp();
+
+#ifdef USE_FAULT_INJECT
+    //
+    // Substitute synthetic measurements for the duration of an injected scenario
+    //
+    if( Fault.InjectTicks ) {
+        Fault.InjectTicks--;
+        switch( Fault.Inject ) {
+            case FAULT_OPEN:     Current = 0;                       PWM = 500; break;
+            case FAULT_SHORT:    Current = FAULT_SHORT_CURRENT + 1;            break;
+            case FAULT_LOCK:     Freq    = SG3525Set.Freq + FAULT_LOCK_HZ + 1; break;
+            case FAULT_BROWNOUT: Vcc     = 0;                                  break;
+            case FAULT_OVERTEMP: Temp    = THERMAL_TRIP_TEMP;                  break;
+            default:                                                           break;
+            }
+        }
+#endif
+
+    //
+    // Only check while running, and not while the calibration is driving things
+    //
+    if( !SG3525_IS_ON || SG3525Set.PwrMode == PWR_CAL ) {
+        Fault.Settle     = FAULT_SETTLE_TICKS;
+        Fault.OpenCount     = 0;
+        Fault.ShortCount    = 0;
+        Fault.RailCount     = 0;
+        Fault.LockCount     = 0;
+        Fault.BrownoutCount = 0;
+        Fault.OvertempCount = 0;
+        }
+    else if( Fault.Settle )
+        Fault.Settle--;
+    else {
+        uint16_t FreqErr = Freq > SG3525Set.Freq ? Freq - SG3525Set.Freq
+                                                 : SG3525Set.Freq - Freq;
+        bool     Tracking = SG3525Set.PwrMode == PWR_CONST_FREQ && FreqErr > FAULT_LOCK_HZ;
+        bool     OnRail   = SG3525Curr.FreqCWiper == 0 ||
+                            SG3525Curr.FreqCWiper >= FreqCPot_MAX_WIPER;
+
+        if( FaultCount(&Fault.OpenCount,
+                       PWM >= FAULT_OPEN_PWM && Current < FAULT_OPEN_CURRENT,
+                       FAULT_OPEN_TICKS) )
+            FaultLatch(FAULT_OPEN);
+
+        if( FaultCount(&Fault.ShortCount,Current > FAULT_SHORT_CURRENT,FAULT_SHORT_TICKS) )
+            FaultLatch(FAULT_SHORT);
+
+        if( FaultCount(&Fault.RailCount,Tracking && OnRail,FAULT_RAIL_TICKS) |
+            FaultCount(&Fault.LockCount,Tracking          ,FAULT_LOCK_TICKS) )
+            FaultLatch(FAULT_LOCK);
+
+        if( FaultCount(&Fault.BrownoutCount,Vcc < SUPPLY_MIN_VCC,FAULT_BROWNOUT_TICKS) )
+            FaultLatch(FAULT_BROWNOUT);
+
+        if( FaultCount(&Fault.OvertempCount,Temp >= THERMAL_TRIP_TEMP,FAULT_OVERTEMP_TICKS) )
+            FaultLatch(FAULT_OVERTEMP);
+        }
+
+    //
+    // Apply the actions of everything latched
+    //
+    if( Fault.Latched == 0 )
+        return;
+
+    if( SG3525_IS_ON && FaultStopped() )
+        SG3525Run(false);
+
+    if( SG3525Curr.PWMLimit > Fault.DerateWiper )
+        SG3525Curr.PWMLimit = Fault.DerateWiper;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultParse - Convert typed fault abbreviation to code
+//
+// Inputs:      Typed text (OP, SH, LK, BO, or OT)
+//
+// Outputs:     Fault code, FAULT_NONE if not recognized
+//
+static FAULT_CODE FaultParse(char *Text) {
+
+    if( StrEQ(Text,"OP") ) return FAULT_OPEN;
+    if( StrEQ(Text,"SH") ) return FAULT_SHORT;
+    if( StrEQ(Text,"LK") ) return FAULT_LOCK;
+    if( StrEQ(Text,"BO") ) return FAULT_BROWNOUT;
+    if( StrEQ(Text,"OT") ) return FAULT_OVERTEMP;
+
+    return FAULT_NONE;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultPrint - Print out fault status
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+static void FaultPrint(void) {
+
+    StartMsg();
+    for( uint8_t i = 0; i < NUM_FAULTS; i++ ) {
+        FAULT_CODE Code = FAULT_OPEN + i;
+
+        PrintD(Code,0);
+        PrintChar(' ');
+        PrintStringP(FaultName(Code));
+        PrintChar(' ');
+        PrintStringP(FaultActionText[IDX_FAULT_ACTION(FaultAction(Code))]);
+        if( Fault.Latched & (1 << i) )
+            PrintStringP(PSTR(" LATCHED"));
+        PrintCRLF();
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultCmd - FA - Show fault status, clear faults, or set fault actions
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// FA           - Show fault status
+// FA C         - Clear latched faults
+// FA xx [W|D|S]- Set action for fault (OP..OT) to warn, derate, or stop
+//
+void FaultCmd(uint8_t Argc,char *Argv[]) {
+    char        *FaultText = Argv[1];
+    FAULT_CODE   Code;
+
+    if( !strlen(FaultText) ) {
+        FaultPrint();
+        return;
+        }
+
+    if( StrEQ(FaultText,"C") ) {
+        FaultClear();
+        StartMsg();
+        PrintStringP(PSTR("Faults cleared"));
+        return;
+        }
+
+    Code = FaultParse(FaultText);
+    if( Code == FAULT_NONE ) {
+        StartMsg();
+        PrintStringP(PSTR("Unrecognized fault ("));
+        PrintString(FaultText);
+        PrintStringP(PSTR("), must be C, OP, SH, LK, BO, or OT.\r\n"));
+        PrintStringP(PSTR("Type '?' for help\r\n"));
+        return;
+        }
+
+    char *ActionText = Argv[2];
+
+    if     ( StrEQ(ActionText,"W") ) EEPROM.FaultActions[IDX_FAULT(Code)] = FAULT_WARN;
+    else if( StrEQ(ActionText,"D") ) EEPROM.FaultActions[IDX_FAULT(Code)] = FAULT_DERATE;
+    else if( StrEQ(ActionText,"S") ) EEPROM.FaultActions[IDX_FAULT(Code)] = FAULT_STOP;
+    else {
+        StartMsg();
+        PrintStringP(PSTR("Unrecognized fault action ("));
+        PrintString(ActionText);
+        PrintStringP(PSTR("), must be W, D, or S.\r\n"));
+        PrintStringP(PSTR("Type '?' for help\r\n"));
+        return;
+        }
+
+    FaultPrint();
+    }
+
+
+#ifdef USE_FAULT_INJECT
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultInjectCmd - FI xx - Inject a fault scenario (OP..OT) into the classifier
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+void FaultInjectCmd(uint8_t Argc,char *Argv[]) {
+    char *FaultText = Argv[1];
+
+    Fault.Inject      = FaultParse(FaultText);
+    Fault.InjectTicks = FAULT_INJECT_TICKS;
+
+    StartMsg();
+    if( Fault.Inject == FAULT_NONE ) {
+        Fault.InjectTicks = 0;
+        PrintStringP(PSTR("Unrecognized fault ("));
+        PrintString(FaultText);
+        PrintStringP(PSTR("), must be OP, SH, LK, BO, or OT.\r\n"));
+        PrintStringP(PSTR("Type '?' for help\r\n"));
+        return;
+        }
+
+    PrintStringP(PSTR("Injecting "));
+    PrintStringP(FaultName(Fault.Inject));
+    }
+#endif
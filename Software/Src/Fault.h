@@ -0,0 +1,262 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Fault.h - Transducer fault diagnostics
+//
+//  SYNOPSIS
+//
+//      //////////////////////////////////////
+//      //
+//      // In Fault.h
+//      //
+//      ...Choose detection thresholds      (Default: see below)
+//      ...Choose fault injection           (Default: enabled)
+//
+//      //////////////////////////////////////
+//      //
+//      // In SG3525.c
+//      //
+//      FaultInit();                        // Called once at startup
+//
+//      SG3525Curr.PWMLimit = PWMPot_MAX_WIPER;
+//      FaultUpdate();                      // Called every tick, after measurements
+//
+//      if( FaultStopped() ) ...            // TRUE if a STOP fault is latched
+//
+//      FaultClear();                       // Reset all latched faults
+//
+//  DESCRIPTION
+//
+//      Watch the measured current, PWM duty, frequency error and coarse wiper position
+//        while the transducer is running, and classify the following faults:
+//
+//          FAULT_OPEN      Transducer disconnected: PWM is driving but no current flows
+//          FAULT_SHORT     Transducer shorted: current above the short threshold
+//          FAULT_LOCK      Loss of lock: coarse wiper at its rail with a frequency error,
+//                            or a frequency error that persists too long
+//          FAULT_BROWNOUT  Supply voltage below SUPPLY_MIN_VCC (see Supply.h)
+//          FAULT_OVERTEMP  Board at or above THERMAL_TRIP_TEMP (see Thermal.h)
+//
+//      Each fault must persist for a number of consecutive ticks before it is
+//        latched. Once latched, a fault stays latched until cleared by the user
+//        (FA C) and the configured action is taken:
+//
+//          FAULT_WARN      Print a message only
+//          FAULT_DERATE    Limit the PWM wiper to half its value when the fault hit
+//          FAULT_STOP      Turn the output off, and hold it off until cleared
+//
+//      The actions are kept with the setups in EEPROM, and are saved with the
+//        "SS" command.
+//
+//      All checks are a handful of integer compares per tick.
+//
+//  VERSION:    2015.08.20
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <avr/pgmspace.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Ignore the first few ticks after the output turns on, while the PWM and frequency
+//   measurements settle.
+//
+#define FAULT_SETTLE_TICKS      12          // ~1/2 second
+
+//
+// Open: PWM at least this wide with less than this much current
+//
+#define FAULT_OPEN_PWM          100         // % x 10
+#define FAULT_OPEN_CURRENT      2           // Amps x 10
+#define FAULT_OPEN_TICKS        25          // ~1 second
+
+//
+// Short: Current above this value
+//
+#define FAULT_SHORT_CURRENT     150         // Amps x 10
+#define FAULT_SHORT_TICKS       3
+
+//
+// Lock: Frequency error larger than this, with the coarse wiper on a rail for
+//   FAULT_RAIL_TICKS or for FAULT_LOCK_TICKS without the rail.
+//
+#define FAULT_LOCK_HZ           100
+#define FAULT_RAIL_TICKS        25          // ~1 second
+#define FAULT_LOCK_TICKS        250         // ~10 seconds (max 255)
+
+//
+// Brownout: Vcc below SUPPLY_MIN_VCC
+//
+#define FAULT_BROWNOUT_TICKS    3
+
+//
+// Overtemp: Temperature at or above THERMAL_TRIP_TEMP
+//
+#define FAULT_OVERTEMP_TICKS    25          // ~1 second
+
+//
+// Uncomment this to allow the "FI" command, which injects synthetic measurements into
+//   the fault classifier for testing.
+//
+#define USE_FAULT_INJECT
+
+#define FAULT_INJECT_TICKS      255         // Length of an injected fault scenario
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fault codes
+//
+typedef enum {
+    FAULT_NONE = 400,       // No fault
+    FAULT_OPEN,             // Transducer open
+    FAULT_SHORT,            // Transducer shorted
+    FAULT_LOCK,             // Frequency loop lost lock
+    FAULT_BROWNOUT,         // Supply voltage too low
+    FAULT_OVERTEMP,         // Board too hot
+    } FAULT_CODE;
+
+#define NUM_FAULTS      ( FAULT_OVERTEMP - FAULT_OPEN + 1 )
+#define IDX_FAULT(_x_)  (_x_ - FAULT_OPEN)              // Index of 1st real fault
+#define FAULT_MASK(_x_) (1 << IDX_FAULT(_x_))           // Bit in latched mask
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fault actions
+//
+typedef enum {
+    FAULT_WARN = 500,       // Print a message
+    FAULT_DERATE,           // Reduce power
+    FAULT_STOP,             // Turn output off
+    } FAULT_ACTION;
+
+#define NUM_FAULT_ACTIONS       ( FAULT_STOP - FAULT_WARN + 1 )
+#define IDX_FAULT_ACTION(_x_)   (_x_ - FAULT_WARN)      // Index of 1st action
+
+extern const FAULT_ACTION FaultDefaults[NUM_FAULTS] PROGMEM;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultInit - Initialize fault diagnostics
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void FaultInit(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultUpdate - Check for faults, and apply actions of latched faults
+//
+// Inputs:      None. (Called every tick, after SG3525Curr has been updated)
+//
+// Outputs:     None.
+//
+// NOTE: May lower SG3525Curr.PWMLimit, which the caller must reset before calling.
+//
+void FaultUpdate(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultClear - Clear all latched faults
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void FaultClear(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultGet     - Return the first latched fault
+// FaultStopped - Return TRUE if a fault with action FAULT_STOP is latched
+//
+// Inputs:      None.
+//
+// Outputs:     Fault code, FAULT_NONE if no fault latched
+//              TRUE if output is being held off by a fault
+//
+FAULT_CODE FaultGet(void);
+bool       FaultStopped(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultName - Return printable name of fault
+//
+// Inputs:      Fault code
+//
+// Outputs:     PROGMEM string, 5 chars wide
+//
+PGM_P FaultName(FAULT_CODE Fault);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FaultxxCmd - Typed commands aimed at the fault system
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// Called from the command table in Command.c
+//
+void FaultCmd(uint8_t Argc,char *Argv[]);               // FA
+
+#ifdef USE_FAULT_INJECT
+void FaultInjectCmd(uint8_t Argc,char *Argv[]);         // FI
+#endif
+
+
+#endif  // FAULT_H - entire file
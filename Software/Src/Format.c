@@ -0,0 +1,211 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Format.c - Line templates, checked at compile time
+//
+//  SYNOPSIS
+//
+//      See Format.h for details
+//
+//  DESCRIPTION
+//
+//      Render a PROGMEM template into a line buffer, and queue it as one block
+//
+//  VERSION:    2015.08.26
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdarg.h>
+#include <stdbool.h>
+
+#include <avr/pgmspace.h>
+
+#include "Format.h"
+#include "Serial.h"
+#include "SerialLong.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FormatHex - Convert integer to hex digits
+//
+// Inputs:      Where the digits should end (one past the last digit)
+//              Integer to convert
+//
+// Outputs:     First digit of the conversion
+//
+static char *FormatHex(char *End,uint16_t Value) {
+
+    do {
+        uint8_t Nibble = Value & 0x0F;
+
+        *--End = Nibble < 10 ? '0' + Nibble : 'A' - 10 + Nibble;
+        Value >>= 4;
+        } while( Value );
+
+    return End;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PrintFormatP - Print a line from a PROGMEM template
+//
+// Inputs:      Template in PROGMEM
+//              Values for the placeholders
+//
+// Outputs:     None.
+//
+// Each placeholder is converted straight into the line, padded by PadField(). If the
+//   line fills up, what's there so far is queued and the line starts over.
+//
+void PrintFormatP(PGM_P Format,...) {
+    char     Line[FORMAT_MAX];
+    char    *Out = Line;
+    char     Char;
+    va_list  Args;
+
+    va_start(Args,Format);
+
+    while( (Char = pgm_read_byte(Format++)) != 0 ) {
+
+        if( Out >= Line + sizeof(Line) - PRINTD_MAX ) {
+            PrintBlock(Line,Out-Line);
+            Out = Line;
+            }
+
+        if( Char != '%' ) {
+            *Out++ = Char;
+            continue;
+            }
+
+        //
+        // Placeholder: flags, width, precision, size, and type
+        //
+        int8_t  Width  = 0;
+        bool    Left   = false;
+        bool    Zero   = false;
+        bool    Tenths = false;
+        bool    Long   = false;
+
+        Char = pgm_read_byte(Format++);
+
+        if( Char == '-' ) { Left = true; Char = pgm_read_byte(Format++); }
+        if( Char == '0' ) { Zero = true; Char = pgm_read_byte(Format++); }
+
+        while( Char >= '0' && Char <= '9' ) {
+            Width = Width < 10 ? Width*10 + (Char - '0') : PRINTD_MAX;
+            Char  = pgm_read_byte(Format++);
+            }
+
+        if( Width > PRINTD_MAX )
+            Width = PRINTD_MAX;
+
+        if( Char == '.' ) {
+            Tenths = (pgm_read_byte(Format++) == '1');
+            Char   = pgm_read_byte(Format++);
+            }
+
+        if( Char == 'l' ) {
+            Long = true;
+            Char = pgm_read_byte(Format++);
+            }
+
+        if( Left ) Width = -Width;
+        if( Zero ) Width += 100;
+
+        char    Digits[12];
+        char   *End   = Digits + sizeof(Digits) - 1;
+        char   *First = End;
+
+        switch( Char ) {
+
+            case 'u':
+                if( Long ) First = FormatLD(End,va_arg(Args,uint32_t));
+                else       First = FormatD (End,va_arg(Args,unsigned));
+
+                //
+                // Tenths: at least "0.x", with the point slipped in before the last digit
+                //
+                if( Tenths ) {
+                    if( First == End-1 )
+                        *--First = '0';
+                    End[0]  = End[-1];
+                    End[-1] = '.';
+                    End++;
+                    }
+                break;
+
+            case 'X':
+                First = FormatHex(End,va_arg(Args,unsigned));
+                break;
+
+            case 'c':
+                *--First = (char) va_arg(Args,int);
+                break;
+
+            case 's': {
+                PGM_P   String = va_arg(Args,PGM_P);
+                int8_t  Pad    = (Width < 0 ? -Width : Width % 100) - strlen_P(String);
+
+                if( Width > 0 )
+                    while( Pad-- > 0 )
+                        *Out++ = ' ';
+
+                while( (Char = pgm_read_byte(String++)) != 0 ) {
+                    if( Out >= Line + sizeof(Line) - PRINTD_MAX ) {
+                        PrintBlock(Line,Out-Line);
+                        Out = Line;
+                        }
+                    *Out++ = Char;
+                    }
+
+                if( Width < 0 )
+                    while( Pad-- > 0 )
+                        *Out++ = ' ';
+                continue;
+                }
+
+            case '%':
+                *--First = '%';
+                break;
+
+            default:
+                *--First = '?';
+                break;
+            }
+
+        Out = PadField(Out,First,End-First,Width);
+        }
+
+    va_end(Args);
+
+    PrintBlock(Line,Out-Line);
+    }
@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Format.h - Line templates, checked at compile time
+//
+//  SYNOPSIS
+//
+//      PrintF("Freq %5u Hz\r\n",Freq);                 // Freq is uint16_t
+//      PrintF(CURSOR_AT(22,1) "%5u",Freq);             // Position and value together
+//      PrintF("Curr %5.1u A",Current);                 // Current in amps x 10
+//      PrintF("Baud %7lu",Baud);                       // Baud is uint32_t
+//      PrintF("Fault: %s",FaultName(Fault));           // PROGMEM string
+//
+//  DESCRIPTION
+//
+//      A status line used to take a call for each piece: a PrintStringP() for the
+//        label, a PrintD() with a magic width (103, -6) for the value, another for
+//        the next label, and so on, each one going through the serial queue.
+//
+//      PrintF() takes the whole line as one template. The template goes into
+//        PROGMEM, is rendered into a line buffer in one pass, and the line is queued
+//        with one PrintBlock().
+//
+//      The template is written in printf() notation, and the compiler checks the
+//        arguments against it as it would for printf(). Format warnings are errors,
+//        so a template with the wrong argument type or count won't build.
+//
+//  PLACEHOLDERS
+//
+//      Only these are rendered, anything else prints as '?':
+//
+//          %u      uint16_t, in decimal
+//          %lu     uint32_t, in decimal
+//          %W.1u   uint16_t in tenths, as "123.4" (%5.1u is the old PrintX10())
+//          %X      uint16_t, in hex
+//          %c      One char
+//          %s      PROGMEM string (not RAM: status text lives in PROGMEM)
+//          %%      A percent sign
+//
+//      Widths and flags are as printf(): %5u is right justified in 5, %-6u is left
+//        justified, and %03u has lead zeroes (PrintD() widths 5, -6 and 103). Widths
+//        are limited to PRINTD_MAX.
+//
+//      The rendered line is limited to FORMAT_MAX chars. A longer template still
+//        prints, but as more than one block.
+//
+//  VERSION:    2015.08.26
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdint.h>
+
+#include <avr/pgmspace.h>
+
+#include "Serial.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Longest line rendered as one block
+//
+#define FORMAT_MAX  64
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma GCC diagnostic error "-Wformat"
+
+//
+// Never called or defined: it's only there so that the compiler checks the template.
+//   It sits inside sizeof(), so no code is generated for it.
+//
+int FormatCheck(const char *Format,...) __attribute__((format(printf,1,2)));
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PrintF - Print a line from a template
+//
+// Inputs:      Template string literal
+//              Values for the placeholders
+//
+// Outputs:     None.
+//
+#define PrintF(_fmt_,...)   ((void) sizeof(FormatCheck(_fmt_,##__VA_ARGS__)),       \
+                             PrintFormatP(PSTR(_fmt_),##__VA_ARGS__))
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PrintFormatP - Print a line from a PROGMEM template
+//
+// Inputs:      Template in PROGMEM
+//              Values for the placeholders
+//
+// Outputs:     None.
+//
+// Not checked. Use PrintF() instead, unless the template is already in PROGMEM.
+//
+void PrintFormatP(PGM_P Format,...);
+
+#endif  // FORMAT_H - entire file
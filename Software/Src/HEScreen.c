@@ -37,31 +37,57 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
+#include "PortMacros.h"
 #include "HEScreen.h"
 #include "Serial.h"
 #include "VT100.h"
 #include "Command.h"
+#include "Format.h"
 
 #ifdef USE_HELP_SCREEN
 
-static const prog_char HEScreenText[] = HELP_SCREEN;
+//
+// The commands are listed from the command table, two to a line
+//
+#define HE_TOP_ROW      3
+#define HE_RIGHT_COL    41
+
+static const prog_char HEScreenText[] = "-- Sone ultrasonic power supply commands --\r\n";
+
+static uint8_t HENext NOINIT;               // Next command table entry to list
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 // ShowHEScreen - Display the command help screen
 //
-// Inputs:      None.
+// Inputs:      Step of the drawing, starting from 0
 //
-// Outputs:     None.
+// Outputs:     TRUE  if more steps follow
+//              FALSE if the screen is drawn
+//
+// After the title, each step lists one command, left column then right. The help
+//   comes from the command table, so it can't drift from the commands there are.
 //
-void ShowHEScreen(void) {
+bool ShowHEScreen(uint8_t Step) {
+
+    if( Step == 0 ) {
+        CursorHome;
+        ClearScreen;
+        ScreenText(HEScreenText);
+        HENext = 0;
+        return true;
+        }
+
+    Step--;
+    PrintF("\033[%u;%uH",HE_TOP_ROW + Step/2,Step & 1 ? HE_RIGHT_COL : 1);
 
-    CursorHome;
-    ClearScreen;
-    PrintStringP(HEScreenText);
+    HENext = CommandHelp(HENext);
+    if( HENext )
+        return true;
 
     UpdateHEScreen();
+    return false;
     }
 
 //////////////////////////////////////////////////////////////////////////////////////////
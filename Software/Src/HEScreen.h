@@ -49,11 +49,12 @@
 //
 // ShowHEScreen - Show command help screen
 //
-// Inputs:      None
+// Inputs:      Step of the drawing, starting from 0
 //
-// Outputs:     None.
+// Outputs:     TRUE  if more steps follow
+//              FALSE if the screen is drawn
 //
-void ShowHEScreen(void);
+bool ShowHEScreen(uint8_t Step);
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -72,7 +73,7 @@ bool HEScreenCommand(char *Command);
 
 #else   // USE_HESCREEN
 
-#define ShowHEScreen()
+#define ShowHEScreen(_s_)  false
 #define UpdateHEScreen()
 
 #endif  // USE_HESCREEN
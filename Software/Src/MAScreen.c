@@ -43,12 +43,17 @@
 
 #include "SG3525.h"
 #include "Setup.h"
+#include "Fault.h"
+#include "Supply.h"
+#include "Thermal.h"
+#include "Timer.h"
 
 #include <stdlib.h>
 
 #include "Command.h"
 #include "Parse.h"
 #include "Serial.h"
+#include "Format.h"
 #include "VT100.h"
 
 #include "Debug.h"
@@ -62,6 +67,37 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 
 static bool PromptNeeded;           // TRUE if need to replot the prompt
+
+//
+// The value last drawn in each field. A refresh redraws only the fields that changed,
+//   unless MADrawnValid is FALSE (screen just drawn, or some output was dropped).
+//
+typedef enum {
+    MA_STATUS = 0,
+    MA_FREQ,
+    MA_CURRENT,
+    MA_POWER,
+    MA_PWM,
+    MA_VCC,
+    MA_TEMP,
+    MA_MARGIN,
+    MA_FAULT,
+    MA_SUPPLY,
+    MA_LOCK,
+    MA_ACQ,
+    MA_FSET,
+    MA_PSET,
+    MA_DEBUG1,
+    MA_DEBUG2,
+    MA_DEBUG3,
+    MA_DEBUG4,
+    NUM_MA_FIELDS
+    } MA_FIELD;
+
+static uint16_t MADrawn[NUM_MA_FIELDS];
+static bool     MADrawnValid;       // TRUE if MADrawn[] matches the screen
+static bool     MADrew;             // TRUE if this refresh drew something
+static uint8_t  MARefreshes;        // Refreshes until everything is redrawn
 
 //
 // Static layout of the main screen
@@ -70,12 +106,12 @@ static char MAScreenText[] PROGMEM = "\
 Status:  --- | Freq:  ---- |\r\n\
 Curr  :  --- | Power:  --- |\r\n\
 Vcc   : xxxx | PWM :   --- |\r\n\
-Vc    : xxxx | Power:  --- |\r\n\
+Temp  :  --C | Margn:  --- |\r\n\
 -------------+-------------+\r\n\
-\r\n\
+Fault: ----- | Lim : ----- |\r\n\
 Freq C  : 128\\\r\n\
 PowerSet: 255\\\r\n\
-\r\n\
+Lock  :  --- | Acq  :  --- |\r\n\
 ";
 
 #define MA_COL1      8
@@ -102,14 +138,29 @@ PowerSet: 255\\\r\n\
 #define PWM_ROW      3
 #define PWM_COL      MA_COL2
 
-#define VC_ROW       4
-#define VC_COL       MA_COL1
+#define TEMP_ROW     4
+#define TEMP_COL     MA_COL1
 
+#define FAULT_ROW    6
+#define FAULT_COL    MA_COL1
+
+#define MARGIN_ROW   4
+#define MARGIN_COL   MA_COL2
+
+#define SUPPLY_ROW   6
+#define SUPPLY_COL   MA_COL2
+
 #define FSET_ROW     7
 #define FSET_COL    15
 
 #define PSET_ROW     8
 #define PSET_COL    15
+
+#define LOCK_ROW     9
+#define LOCK_COL     MA_COL1a
+
+#define ACQ_ROW      9
+#define ACQ_COL      MA_COL2
 
 #define DEBUG_ROW   10
 #define MSG_ROW     15
@@ -120,37 +171,53 @@ PowerSet: 255\\\r\n\
 //
 // ShowMAScreen - Display the main screen
 //
-// Inputs:      None.
+// Inputs:      Step of the drawing, starting from 0
 //
-// Outputs:     None.
+// Outputs:     TRUE  if more steps follow
+//              FALSE if the screen is drawn
 //
-void ShowMAScreen(void) {
+bool ShowMAScreen(uint8_t Step) {
 
-    CursorHome;
-    ClearScreen;
-    PrintStringP(MAScreenText);
+    if( Step == 0 ) {
+        CursorHome;
+        ClearScreen;
+        ScreenText(MAScreenText);
+        return true;
+        }
 
-    PromptNeeded = true;
+    //
+    // The fields and debug lines are too much for the Hi queue in one step, so send
+    //   them as a refresh: a field that doesn't fit is dropped whole, and redrawn.
+    //
+    MADrawnValid = false;
+    SerialSetPri(SERIAL_LO);
     UpdateMAScreen();
+    SerialSetPri(SERIAL_HI);
+    return false;
     }
 
-
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// PrintX10 - Print out x10 decimal value with decimal point
+// MAChanged - Check if a field needs to be redrawn
 //
-// Inputs:      Value to print
+// Inputs:      Field to check
+//              Value to be shown in field
 //
-// Outputs:     None.
+// Outputs:     TRUE  if field should be redrawn (and is now marked as drawn)
+//              FALSE if screen already shows the value
 //
-void PrintX10(uint16_t Value) {
-
-    PrintD(Value/10,3);
-    PrintChar('.');
-    PrintChar('0' + (Value%10));
-    }
-
+static bool MAChanged(MA_FIELD Field,uint16_t Value) {
+
+    if( MADrawnValid && MADrawn[Field] == Value )
+        return false;
+
+    MADrawn[Field] = Value;
+    MADrew         = true;
+    return true;
+    }
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -160,95 +227,161 @@ void PrintX10(uint16_t Value) {
 //
 // Outputs:     None.
 //
+// Only fields whose values have changed are sent, so a refresh of a steady display
+//   sends nothing at all.
+//
 void UpdateMAScreen(void) {
+    uint16_t    Dropped = SerialStats.Dropped;
+    uint16_t    Lost    = SerialStats.Lost;
+    uint16_t    Value;
 
     //
-    // Calibration mode takes over the display
+    // Calibration mode takes over the display, redraw everything afterwards
     //
-    if( SG3525Set.PwrMode == PWR_CAL )
+    if( SG3525Set.PwrMode == PWR_CAL ) {
+        MADrawnValid = false;
         return;
+        }
+
+    //
+    // Redraw everything now and then anyway, in case the terminal lost something
+    //
+    if( MARefreshes == 0 ) {
+        MARefreshes  = MA_REDRAW_REFRESHES;
+        MADrawnValid = false;
+        }
+    MARefreshes--;
+
+    MADrew = false;
 
     //////////////////////////////////////////////////////////////////////////////////////
     //
     // Screen-specific display fields
     //
-    CursorPos(STATUS_COL,STATUS_ROW);
-    if( SG3525_IS_ON ) PrintStringP(PSTR(" On"));
-    else               PrintStringP(PSTR("Off"));
+    if( MAChanged(MA_STATUS,SG3525_IS_ON) ) {
+        PrintF(CURSOR_AT(STATUS_COL,STATUS_ROW) "%s",SG3525_IS_ON ? PSTR(" On") : PSTR("Off"));
+        }
 
-    CursorPos(FREQ_COL,FREQ_ROW);
-    PrintD(SG3525Curr.Freq,5);
+    if( MAChanged(MA_FREQ,SG3525Curr.Freq) ) {
+        PrintF(CURSOR_AT(FREQ_COL,FREQ_ROW) "%5u",SG3525Curr.Freq);
+        }
 
-    CursorPos(CURRENT_COL,CURRENT_ROW);
-    PrintX10(SG3525Curr.Current);
+    if( MAChanged(MA_CURRENT,SG3525Curr.Current) ) {
+        PrintF(CURSOR_AT(CURRENT_COL,CURRENT_ROW) "%5.1u",SG3525Curr.Current);
+        }
 
-    CursorPos(POWER_COL,POWER_ROW);
-    PrintX10(SG3525Curr.Power);
+    if( MAChanged(MA_POWER,SG3525Curr.Power) ) {
+        PrintF(CURSOR_AT(POWER_COL,POWER_ROW) "%5.1u",SG3525Curr.Power);
+        }
 
-    CursorPos(PWM_COL,PWM_ROW);
-    PrintX10(SG3525Curr.PWM);
+    if( MAChanged(MA_PWM,SG3525Curr.PWM) ) {
+        PrintF(CURSOR_AT(PWM_COL,PWM_ROW) "%5.1u",SG3525Curr.PWM);
+        }
+
+    if( MAChanged(MA_VCC,SG3525Curr.Vcc) ) {
+        PrintF(CURSOR_AT(VCC_COL,VCC_ROW) "%5.1u",SG3525Curr.Vcc);
+        }
+
+    Value = ThermalGetTemp() > 0 ? ThermalGetTemp() : 0;
+    if( MAChanged(MA_TEMP,Value) ) {
+        PrintF(CURSOR_AT(TEMP_COL,TEMP_ROW) "%4u",Value);
+        }
+
+    Value = SG3525Curr.Vcc > SUPPLY_MIN_VCC ? SG3525Curr.Vcc - SUPPLY_MIN_VCC : 0;
+    if( MAChanged(MA_MARGIN,Value) ) {
+        PrintF(CURSOR_AT(MARGIN_COL,MARGIN_ROW) "%5.1u",Value);
+        }
+
+    if( MAChanged(MA_FAULT,FaultGet()) ) {
+        PrintF(CURSOR_AT(FAULT_COL,FAULT_ROW) "%s",FaultName(FaultGet()));
+        }
+
+    if( MAChanged(MA_SUPPLY,SupplyGetState()) ) {
+        PrintF(CURSOR_AT(SUPPLY_COL,SUPPLY_ROW) "%s",SupplyName(SupplyGetState()));
+        }
+
+    if( MAChanged(MA_LOCK,SG3525Lock.Locked) ) {
+        PrintF(CURSOR_AT(LOCK_COL,LOCK_ROW) "%s",SG3525Lock.Locked ? PSTR("Yes") : PSTR(" No"));
+        }
+
+    Value = (((uint32_t) SG3525Lock.AcquireTicks)*MS_PER_TICK)/100;     // Secs x 10
+    if( MAChanged(MA_ACQ,Value) ) {
+        PrintF(CURSOR_AT(ACQ_COL,ACQ_ROW) "%5.1u",Value);
+        }
 
 #ifdef USE_WIPER_CMDS
-    CursorPos(FSET_COL,FSET_ROW);
-    PrintD(SG3525Curr.FreqCWiper,5);    // == %5d
+    if( MAChanged(MA_FSET,SG3525Curr.FreqCWiper) ) {
+        PrintF(CURSOR_AT(FSET_COL,FSET_ROW) "%5u",SG3525Curr.FreqCWiper);
+        }
 
-    CursorPos(PSET_COL,PSET_ROW);
-    PrintX10(SG3525Curr.PWMWiper);
+    if( MAChanged(MA_PSET,SG3525Curr.PWMWiper) ) {
+        PrintF(CURSOR_AT(PSET_COL,PSET_ROW) "%5.1u",SG3525Curr.PWMWiper);
+        }
 #else
-    CursorPos(FSET_COL,FSET_ROW);
-    PrintD(SG3525Curr.Freq,5);          // == %5d
+    if( MAChanged(MA_FSET,SG3525Curr.Freq) ) {
+        PrintF(CURSOR_AT(FSET_COL,FSET_ROW) "%5u",SG3525Curr.Freq);
+        }
 
-    CursorPos(PSET_COL,PSET_ROW);
-    PrintX10(SG3525Set.Power);
+    if( MAChanged(MA_PSET,SG3525Set.Power) ) {
+        PrintF(CURSOR_AT(PSET_COL,PSET_ROW) "%5.1u",SG3525Set.Power);
+        }
 #endif
 
-    CursorPos(1,DEBUG_ROW);
-    DebugPrint();
+    //
+    // The debug probes print as a block, redraw it if any of them changed
+    //
+    bool DebugChanged = MAChanged(MA_DEBUG1,Debug1);
+    DebugChanged     |= MAChanged(MA_DEBUG2,Debug2);
+    DebugChanged     |= MAChanged(MA_DEBUG3,Debug3);
+    DebugChanged     |= MAChanged(MA_DEBUG4,Debug4);
+
+#ifdef DEBUG_CPU_COUNT
+    DebugChanged = true;
+    MADrew       = true;
+#endif
+
+    if( DebugChanged ) {
+        CursorPos(1,DEBUG_ROW);
+        DebugPrint();
+        }
 
     //
     //
     //
     //////////////////////////////////////////////////////////////////////////////////////
 
+    //
+    // A field that was dropped from either queue isn't on the screen, so draw
+    //   everything again next time.
+    //
+    MADrawnValid = (SerialStats.Dropped == Dropped && SerialStats.Lost == Lost);
+
     if( PromptNeeded )
         Prompt();
+
+    if( PromptNeeded || MADrew )
+        PlotInput();
+
     PromptNeeded = false;
-    
-    PlotInput();
     }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// MAScreenCommand
+// MAClearCmd - CL - Clear the message area
 //
-// Inputs:      Command entered at screen
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
 //
-// Outputs:     TRUE  if we understood and processed command
-//              FALSE if command isn't ours, belongs to another system
+// Outputs:     None.
+//
+// The commands for the main screen are in the table in Command.c
 //
 #ifdef USE_MAIN_SCREEN_CMDS
 
-bool MAScreenCommand(char *Command) {
-
-    if( SG3525Cmd(Command) )
-        return true;
+void MAClearCmd(uint8_t Argc,char *Argv[]) {
 
-    if( SetupCmd(Command) )
-        return true;
-
-    //
-    // CL - Clear the message area
-    //
-    if( StrEQ(Command,"CL") ) {
-        StartMsg();
-        return true;
-        }
-
-    //
-    // Command was unrecognized by this panel - caller must take responsibility
-    //
-    return false;
+    StartMsg();
     }
 
 
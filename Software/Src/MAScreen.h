@@ -49,11 +49,12 @@
 //
 // ShowMAScreen - Show main screen
 //
-// Inputs:      None
+// Inputs:      Step of the drawing, starting from 0
 //
-// Outputs:     None.
+// Outputs:     TRUE  if more steps follow
+//              FALSE if the screen is drawn
 //
-void ShowMAScreen(void);
+bool ShowMAScreen(uint8_t Step);
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -67,7 +68,7 @@ void ShowMAScreen(void);
 void UpdateMAScreen(void);
 
 #ifdef USE_MAIN_SCREEN_CMDS
-bool MAScreenCommand(char *Command);
+void MAClearCmd(uint8_t Argc,char *Argv[]);             // CL
 #endif
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -83,7 +84,7 @@ void StartMsg(void);
 
 #else   // USE_MASCREEN
 
-#define ShowMAScreen()
+#define ShowMAScreen(_s_)  false
 #define UpdateMAScreen()
 
 #endif  // USE_MASCREEN
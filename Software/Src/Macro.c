@@ -0,0 +1,250 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Macro.c - Named command macros, kept in EEPROM
+//
+//  SYNOPSIS
+//
+//      See Macro.h for details
+//
+//  DESCRIPTION
+//
+//      Keep short command lines by name, and run them as if typed
+//
+//  VERSION:    2015.08.29
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <ctype.h>
+#include <avr/pgmspace.h>
+
+#include "PortMacros.h"
+#include "Macro.h"
+#include "EEPROM.h"
+#include "Command.h"
+#include "Serial.h"
+#include "VT100.h"
+#include "MAScreen.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data declarations
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+bool MacroRunning;                          // TRUE while a macro is being run
+
+static const char *MacroPending;            // Macro posted to run, or NULL
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FindMacro - Look up a macro by name
+//
+// Inputs:      Macro name, in upper case ("" finds an unused entry)
+//
+// Outputs:     Ptr to macro in the EEPROM copy
+//              NULL if not found
+//
+static MACRO *FindMacro(const char *Name) {
+
+    for( uint8_t i = 0; i < MAX_MACROS; i++ )
+        if( strcmp(EEPROM.Macros[i].Name,Name) == 0 )
+            return &EEPROM.Macros[i];
+
+    return NULL;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// MacroRun - Run a macro, by name
+//
+// Inputs:      Macro name, in upper case
+//
+// Outputs:     TRUE  if there is a macro by that name (and it was run)
+//              FALSE otherwise
+//
+// The text is split in place as it's run, so it's run from a copy.
+//
+bool MacroRun(const char *Name) {
+    MACRO  *Macro;
+    char    Line[MACRO_LENGTH+1];
+
+    if( Name[0] == 0 || (Macro = FindMacro(Name)) == NULL )
+        return false;
+
+    if( MacroRunning ) {
+        StartMsg();
+        PrintStringP(PSTR("Macro not run ("));
+        PrintString(Name);
+        PrintStringP(PSTR("), a macro can't run a macro\r\n"));
+        return true;
+        }
+
+    strcpy(Line,Macro->Text);
+    MacroRunning = true;
+    CommandLine(Line);
+    MacroRunning = false;
+    return true;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// MacroPost - Have a macro run from the main loop
+//
+// Inputs:      Macro name, in upper case
+//
+// Outputs:     None.
+//
+void MacroPost(const char *Name) { MacroPending = Name; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// MacroUpdate - Run a posted macro, if any
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void MacroUpdate(void) {
+    const char *Name = MacroPending;
+
+    if( Name ) {
+        MacroPending = NULL;
+        MacroRun(Name);
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// MacroCmd - MD - Define, delete, or list macros
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+//      MD              List the macros
+//      MD x            Delete macro x
+//      MD x ...        Define macro x as the rest of the line
+//
+void MacroCmd(uint8_t Argc,char *Argv[]) {
+    char   *Name = Argv[1];
+    char   *Text = Argv[2];
+    MACRO  *Macro;
+    uint8_t Len;
+
+    StartMsg();
+
+    //
+    // MD - List
+    //
+    if( Argc == 1 ) {
+        bool Any = false;
+
+        for( uint8_t i = 0; i < MAX_MACROS; i++ ) {
+            if( EEPROM.Macros[i].Name[0] == 0 )
+                continue;
+            PrintString(EEPROM.Macros[i].Name);
+            PrintStringP(PSTR(": "));
+            PrintString(EEPROM.Macros[i].Text);
+            PrintCRLF();
+            Any = true;
+            }
+
+        if( !Any )
+            PrintStringP(PSTR("No macros"));
+        return;
+        }
+
+    for( Len = 0; Name[Len]; Len++ )
+        Name[Len] = toupper(Name[Len]);
+
+    if( Len >= sizeof(Macro->Name) ) {
+        PrintStringP(PSTR("Bad macro name ("));
+        PrintString(Name);
+        PrintStringP(PSTR("), must be 1 to 3 chars\r\n"));
+        return;
+        }
+
+    if( CommandKnown(Name) ) {
+        PrintStringP(PSTR("Bad macro name ("));
+        PrintString(Name);
+        PrintStringP(PSTR("), that's a command\r\n"));
+        return;
+        }
+
+    Macro = FindMacro(Name);
+
+    //
+    // MD x - Delete
+    //
+    if( Argc == 2 ) {
+        if( Macro == NULL ) {
+            PrintStringP(PSTR("No such macro ("));
+            PrintString(Name);
+            PrintStringP(PSTR(")\r\n"));
+            return;
+            }
+
+        Macro->Name[0] = 0;
+        EEPROMWriteField(*Macro);
+        PrintStringP(PSTR("Macro deleted"));
+        return;
+        }
+
+    //
+    // MD x ... - Define, in place of any old one
+    //
+    if( strlen(Text) > MACRO_LENGTH ) {
+        PrintStringP(PSTR("Macro too long, " __xstr__(MACRO_LENGTH) " chars at most\r\n"));
+        return;
+        }
+
+    if( Macro == NULL && (Macro = FindMacro("")) == NULL ) {
+        PrintStringP(PSTR("No room, " __xstr__(MAX_MACROS) " macros at most (MD x to delete)\r\n"));
+        return;
+        }
+
+    strcpy(Macro->Name,Name);
+    strcpy(Macro->Text,Text);
+    EEPROMWriteField(*Macro);
+    PrintStringP(PSTR("Macro saved"));
+    }
@@ -0,0 +1,144 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Macro.h - Named command macros, kept in EEPROM
+//
+//  SYNOPSIS
+//
+//      Cmd> MD R1 LS 2;PO 35%;ON           // Define macro R1
+//      Cmd> R1                             // Run it, by name
+//      Cmd> MD                             // List the macros
+//      Cmd> MD R1                          // Delete R1
+//
+//      Cmd> MD I1 ST;FR 28.5k;PO 25W;ST C  // Macro for input 1
+//      Cmd> MO I1 MC                       // Run it when input 1 is pressed
+//
+//  DESCRIPTION
+//
+//      A macro is a short command line with a name, saved in EEPROM with the setups.
+//        It's run as if it had been typed, commands and separators and all, inside one
+//        main loop pass. A whole recipe change can then be one name, or one button.
+//
+//      Names are 1 to 3 chars, in either case. A command in the table wins over a
+//        macro of the same name, so MD won't define a macro with a command's name.
+//
+//      The commands in a macro are found whatever screen is showing, so a macro
+//        works the same from any screen.
+//
+//      An input with action MC (see "MO Ix") runs the macro named for it, I1 or I2,
+//        when pressed. The press is noted in the tick, and the macro is run from the
+//        main loop (MacroUpdate), never in the middle of the control update.
+//
+//      A macro can't run another macro.
+//
+//  VERSION:    2015.08.29
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef MACRO_H
+#define MACRO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Number of macros, and longest macro text. Each one takes 4+MACRO_LENGTH+1 bytes of
+//   EEPROM, and as much RAM for the EEPROM copy.
+//
+#define MAX_MACROS      4
+#define MACRO_LENGTH    30
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+    char    Name[4];                        // Upper case, NUL terminated, "" if unused
+    char    Text[MACRO_LENGTH+1];           // Command line, NUL terminated
+    } MACRO;
+
+extern bool MacroRunning;                   // TRUE while a macro is being run
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// MacroRun - Run a macro, by name
+//
+// Inputs:      Macro name, in upper case
+//
+// Outputs:     TRUE  if there is a macro by that name (and it was run)
+//              FALSE otherwise
+//
+bool MacroRun(const char *Name);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// MacroPost - Have a macro run from the main loop
+//
+// Inputs:      Macro name, in upper case
+//
+// Outputs:     None.
+//
+// For the tick, which mustn't run commands itself. A later post replaces an earlier
+//   one not yet run.
+//
+void MacroPost(const char *Name);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// MacroUpdate - Run a posted macro, if any
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+// Call from the main loop, outside the tick.
+//
+void MacroUpdate(void);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// MacroCmd - MD - Define, delete, or list macros
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+void MacroCmd(uint8_t Argc,char *Argv[]);
+
+#endif  // MACRO_H - entire file
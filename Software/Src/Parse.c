@@ -11,14 +11,13 @@
 //
 //      Input (serial) line parsing
 //
-//      Pull the next token from the supplied input line
+//      Split the supplied input line into tokens, in place
 //
 //  NOTE
 //
-//      These functions work from static variables, so can only parse commands
-//        serially in order. Cannot parse 2 lines at once.
-// 
-//  VERSION:    2014.11.05
+//      No static state, see Parse.h
+//
+//  VERSION:    2015.08.27
 //
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -46,16 +45,13 @@
 
 #include <string.h>
 
+#include <avr/pgmspace.h>
+
 #include <PortMacros.h>
 
 #include <Parse.h>
-
-//
-// Maximum size of an input token. In other words, the maximum
-//   number of characters in a command, or between two delimiters
-//   or the maximum number of digits in an input number
-//
-#define MAX_TOKEN_LENGTH    10
+#include <SG3525.h>
+#include <Timer.h>
 
 //
 // Any character in the following is a delimiter character.
@@ -66,56 +62,186 @@
 //
 // IsDelimiter() macro
 //
-#define IsDelimiter(__char__)   strchr(DELIMITERS,__char__)
+// Note that strchr considers the NUL a searchable character, so we have to make a
+//   special case for it.
+//
+#define IsDelimiter(__char__)   ((__char__) != 0 && strchr(DELIMITERS,__char__))
+
+//
+// At most this many decimal places (as a power of 10)
+//
+#define PARSE_MAX_SCALE 1000
+
+//
+// Unit suffixes. A number with a suffix may have decimals, and is scaled by Mul/Div
+//   into the internal unit. Suffixes are upper case here, but may be typed in
+//   either case.
+//
+typedef struct {
+    UNIT        Unit;
+    char        Suffix[4];
+    uint16_t    Mul;
+    uint16_t    Div;
+    } UNIT_SUFFIX;
 
-static char *LineBuffer              NOINIT;
-static char  Token[MAX_TOKEN_LENGTH] NOINIT;
+static const UNIT_SUFFIX UnitSuffixes[] PROGMEM = {
+    { UNIT_HZ   , "K"  , 1000            , 1           },      // 28.5k
+    { UNIT_HZ   , "KHZ", 1000            , 1           },      // 28.5kHz
+    { UNIT_HZ   , "HZ" , 1               , 1           },      // 28500Hz
+    { UNIT_POWER, "W"  , 10              , 1           },      // 25.5W
+    { UNIT_POWER, "%"  , SG3525_MAX_POWER, 100         },      // 35%, of max power
+    { UNIT_TICKS, "MS" , 1               , MS_PER_TICK },      // 150ms
+    { UNIT_TICKS, "S"  , 1000            , MS_PER_TICK },      // 1.5s
+    };
 
 /////////////////////////////////////////////////////////////////////////////////
 //
-// ParseInit - Initialize command line parsing
+// ParseArgs - Split command line into tokens, in place
 //
-// Inputs:      COmmand line to examine
+// Inputs:      Command line to split (changed by the split)
+//              Array to hold ptrs to tokens
+//              Size of array
 //
-// Outputs:     None.
+// Outputs:     Number of tokens in the line
 //
-void ParseInit(char *Buffer) {
+uint8_t ParseArgs(char *Line,char *Argv[],uint8_t MaxArgs) {
+    uint8_t Argc = 0;
+
+    while( 1 ) {
+
+        //
+        // Skip over delimiters before the token
+        //
+        while( IsDelimiter(*Line) )
+            Line++;
+
+        if( *Line == 0 )
+            break;
+
+        if( Argc < MaxArgs )
+            Argv[Argc] = Line;
+        Argc++;
+
+        //
+        // Skip over the token, and terminate it
+        //
+        while( *Line != 0 && !IsDelimiter(*Line) )
+            Line++;
+
+        if( *Line != 0 )
+            *Line++ = 0;
+        }
+
+    //
+    // Line is now at the terminating NUL, an empty string for missing arguments
+    //
+    for( uint8_t i = Argc; i < MaxArgs; i++ )
+        Argv[i] = Line;
 
-    LineBuffer = Buffer;
+    return(Argc);
     }
 
 /////////////////////////////////////////////////////////////////////////////////
 //
-// ParseToken - Return next token in command buffer
+// ParseValue - Convert a token to a number in internal units
 //
-// Inputs:      None.
+// Inputs:      Token to convert
+//              Unit the number is in (UNIT_xx)
+//              Where to put the number
 //
-// Outputs:     Ptr to next token in command buffer
-//              Empty string if no more tokens
+// Outputs:     TRUE  if the token is good, and fits in 16 bits
+//              FALSE otherwise (the number is unchanged)
 //
-char *ParseToken() {
-    char    *TokenPtr = Token;
+// Unlike atoi(), an empty token, stray chars ("12x") and overflow are all errors,
+//   not quietly zero or wrapped.
+//
+// The digits are gathered as one integer, with a scale of 10 for each decimal
+//   place. The suffix's ratio and the scale then make one multiply and one divide,
+//   rounded. Nothing is converted twice, and no floating point.
+//
+bool ParseValue(const char *Token,UNIT Unit,uint16_t *Value) {
+    uint32_t Num    = 0;
+    uint16_t Scale  = 1;
+    bool     Digits = false;
+    bool     Point  = false;
+    char     Suffix[sizeof(UnitSuffixes[0].Suffix)];
+    uint8_t  Len;
 
-    memset(Token,0,sizeof(Token));
+    for( ; *Token != 0; Token++ ) {
+        uint8_t Digit = *Token - '0';
+
+        if( Digit <= 9 ) {
+            if( Num > 0x0FFFFFFF )              // Far out of range, and
+                return(false);                  //   about to overflow
+
+            if( Point ) {
+                if( Scale >= PARSE_MAX_SCALE )
+                    return(false);
+                Scale *= 10;
+                }
+
+            Num    = Num*10 + Digit;
+            Digits = true;
+            }
+        else if( *Token == '.' && !Point )
+            Point = true;
+        else
+            break;
+        }
+
+    if( !Digits )
+        return(false);
 
     //
-    // Start by skipping over any existing delimiters.
-    //
-    // Note that strchr (in IsDelimiter) considers the NUL a searchable
-    //   character, so we have to make a special case for it.
+    // A bare number is a whole number, already in internal units
     //
-    while( *LineBuffer != 0 && IsDelimiter(*LineBuffer) )
-        LineBuffer++;
+    if( *Token == 0 ) {
+        if( Point || Num > 0xFFFF )
+            return(false);
+
+        *Value = Num;
+        return(true);
+        }
 
     //
-    // Now move token chars into Token array, while keeping track of
-    //   lengths and such
+    // Otherwise, look up the suffix for this unit
     //
-    while( *LineBuffer != 0                 &&
-           !IsDelimiter(*LineBuffer)        &&
-            strlen(Token) < MAX_TOKEN_LENGTH ) {
-        *TokenPtr++ = *LineBuffer++;
+    for( Len = 0; Token[Len] != 0 && Len < sizeof(Suffix)-1; Len++ ) {
+        char Char = Token[Len];
+
+        Suffix[Len] = Char >= 'a' && Char <= 'z' ? Char - 'a' + 'A' : Char;
+        }
+
+    if( Token[Len] != 0 )
+        return(false);
+
+    Suffix[Len] = 0;
+
+    for( uint8_t i = 0; i < NUMOF(UnitSuffixes); i++ ) {
+        UNIT_SUFFIX Def;
+
+        memcpy_P(&Def,&UnitSuffixes[i],sizeof(Def));
+
+        if( Def.Unit != Unit || strcmp(Suffix,Def.Suffix) != 0 )
+            continue;
+
+        //
+        // Any result that fits comes from less than 2^32 here, so an overflow
+        //   means out of range. The rounding term counts too.
+        //
+        uint32_t Div = (uint32_t) Def.Div * Scale;
+
+        if( Num > (0xFFFFFFFF - Div/2)/Def.Mul )
+            return(false);
+
+        Num = (Num*Def.Mul + Div/2)/Div;
+
+        if( Num > 0xFFFF )
+            return(false);
+
+        *Value = Num;
+        return(true);
         }
 
-    return(Token);
+    return(false);
     }
@@ -7,18 +7,49 @@
 //  FILE
 //      Parse.h
 //
+//  SYNOPSIS
+//
+//      char   *Argv[MAX_ARGS];
+//      uint8_t Argc = ParseArgs(Line,Argv,NUMOF(Argv));
+//
+//      if( Argc > NUMOF(Argv) ) ...            // Too many tokens for Argv
+//
+//      Argv[0]                                 // First token (the command)
+//      Argv[1]                                 // Second token, "" if none
+//
+//      if( !ParseNum(Argv[1],&Setup) ) ...     // Not a whole number, or too big
+//      ParseValue("28.5k",UNIT_HZ,&Freq);      // Freq = 28500
+//      ParseValue("25.5W",UNIT_POWER,&Power);  // Power = 255 (watts x 10)
+//
 //  DESCRIPTION
 //
 //      Input (serial) line parsing
 //
-//      Pull the next token from the supplied input line
+//      Split an input line into tokens, in place: the delimiters after each token are
+//        overwritten with NULs, and Argv[] points to the tokens in the line. One pass
+//        over the line, and no copying.
+//
+//      Tokens are not limited in length. Argv[] entries past the last token point to
+//        an empty string, so a missing argument reads as "".
+//
+//      If there are more tokens than Argv[] entries, the extra ones are not stored,
+//        but are still counted: Argc is the number of tokens in the line, and may
+//        be larger than the Argv[] array.
+//
+//      Number arguments are converted by ParseValue(), which is strict: the whole
+//        token must be a number, with a suffix (if any) known for the unit, and fit
+//        in 16 bits.
+//        Decimals are fixed point (up to 3 places), with one 32 bit multiply and
+//        divide to scale them, so there's no floating point, and no atoi() or
+//        strtol() from the library.
 //
 //  NOTE
 //
-//      These functions work from static variables, so can only parse commands
-//        serially in order. Cannot parse 2 lines at once.
-// 
-//  VERSION:    2014.11.05
+//      No static state, so two lines (from two input channels, say) may be parsed at
+//        the same time. The line is changed by the parse.
+//
+//  VERSION:    2015.08.27
+//
 //
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -44,28 +75,54 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
+
 #ifndef PARSE_H
 #define PARSE_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// ParseInit - Initialize command line parsing
+// ParseArgs - Split command line into tokens, in place
 //
-// Inputs:      COmmand line to examine
+// Inputs:      Command line to split (changed by the split)
+//              Array to hold ptrs to tokens
+//              Size of array
 //
-// Outputs:     None.
+// Outputs:     Number of tokens in the line
 //
-void ParseInit(char *Buffer);
+uint8_t ParseArgs(char *Line,char *Argv[],uint8_t MaxArgs);
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// ParseToken - Return next token in command buffer
+// Units a number argument may be in. A bare number is a whole number in the internal
+//   unit, as kept in SG3525_SET. With a suffix it may have decimals, and is
+//   converted to the internal unit, rounded.
+//
+typedef enum {
+    UNIT_NONE = 0,          // Whole number, no suffix
+    UNIT_HZ,                // Hz:          28500, 28.5k, 28.5kHz, 28500Hz
+    UNIT_POWER,             // Watts x 10:  255, 25.5W, 35% (of SG3525_MAX_POWER)
+    UNIT_TICKS,             // Ticks:       25, 150ms, 1.5s
+    } UNIT;
+
+//////////////////////////////////////////////////////////////////////////////////////////
 //
-// Inputs:      None.
+// ParseValue - Convert a token to a number in internal units
+//
+// Inputs:      Token to convert
+//              Unit the number is in (UNIT_xx)
+//              Where to put the number
+//
+// Outputs:     TRUE  if the token is good, and fits in 16 bits
+//              FALSE otherwise (the number is unchanged)
+//
+bool ParseValue(const char *Token,UNIT Unit,uint16_t *Value);
+
 //
-// Outputs:     Ptr to next token in command buffer
-//              Empty string if no more tokens
+// ParseNum - Convert a token to a whole number
 //
-char *ParseToken(void);
+#define ParseNum(_token_,_value_)   ParseValue(_token_,UNIT_NONE,_value_)
 
-#endif  // PARSE_H - Entire file 
+#endif  // PARSE_H - Entire file
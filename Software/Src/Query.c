@@ -0,0 +1,334 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Query.c - GET/SET line protocol, for host programs
+//
+//  SYNOPSIS
+//
+//      See Query.h for details
+//
+//  DESCRIPTION
+//
+//      Answer host requests one line at a time, with the console quiet
+//
+//  VERSION:    2015.08.28
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <ctype.h>
+#include <avr/pgmspace.h>
+
+#include "PortMacros.h"
+#include "Query.h"
+#include "Command.h"
+#include "Screen.h"
+#include "Parse.h"
+#include "Serial.h"
+#include "Format.h"
+#include "SG3525.h"
+#include "Fault.h"
+#include "Thermal.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data declarations
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+bool QueryMode;                             // TRUE when in machine mode
+
+static int QueryScreen NOINIT;              // Screen to go back to, on EXIT
+
+//
+// How a key's value is got (and set)
+//
+typedef enum {
+    KEY_RO = 0,                             // uint16_t, read only
+    KEY_RW,                                 // uint16_t, set within Min..Max
+    KEY_BOOL,                               // bool, read only
+    KEY_RUN,                                // Transducer output, set by SG3525Run()
+    KEY_TEMP,                               // Board temperature
+    KEY_FAULT,                              // First latched fault
+    } KEY_TYPE;
+
+typedef struct {
+    char        Name[8];                    // Lower case, NUL terminated
+    KEY_TYPE    Type;
+    void       *Var;                        // Variable, for RO, RW and BOOL
+    UNIT        Unit;                       // Unit a SET value may be in
+    uint16_t    Min;                        // SET range
+    uint16_t    Max;
+    } QUERY_KEY;
+
+//
+// RO_KEY() entries are uint16_t variables that can't be set, RW_KEY() ones can be set
+//   within _lo_.._hi_, and the rest are got by type.
+//
+#define RO_KEY(_name_,_var_)                    { _name_, KEY_RO, &_var_, UNIT_NONE, 0, 0 },
+#define RW_KEY(_name_,_var_,_unit_,_lo_,_hi_)   { _name_, KEY_RW, &_var_, _unit_, _lo_, _hi_ },
+#define FN_KEY(_name_,_type_,_var_,_hi_)        { _name_, _type_, _var_, UNIT_NONE, 0, _hi_ },
+
+//
+// In the order GET * lists them, settable keys first
+//
+static const QUERY_KEY QueryKeys[] PROGMEM = {
+    RW_KEY("freq"   ,SG3525Set.Freq    ,UNIT_HZ   ,SG3525_MIN_FREQ ,SG3525_MAX_FREQ )
+    RW_KEY("power"  ,SG3525Set.Power   ,UNIT_POWER,SG3525_MIN_POWER,SG3525_MAX_POWER)
+    FN_KEY("run"    ,KEY_RUN  ,NULL,1)
+    RW_KEY("timer"  ,SG3525Set.RunTimer,UNIT_TICKS,0               ,0xFFFF          )
+    RO_KEY("afreq"  ,SG3525Curr.Freq)
+    RO_KEY("current",SG3525Curr.Current)
+    RO_KEY("apower" ,SG3525Curr.Power)
+    RO_KEY("vcc"    ,SG3525Curr.Vcc)
+    RO_KEY("vc"     ,SG3525Curr.Vc)
+    RO_KEY("pwm"    ,SG3525Curr.PWM)
+    FN_KEY("temp"   ,KEY_TEMP ,NULL,0)
+    FN_KEY("fault"  ,KEY_FAULT,NULL,0)
+    FN_KEY("locked" ,KEY_BOOL ,&SG3525Lock.Locked,0)
+    RO_KEY("acquire",SG3525Lock.AcquireTicks)
+    };
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FindKey - Look up a key by name
+//
+// Inputs:      Key name, either case (lower cased in place)
+//
+// Outputs:     Index of key in QueryKeys[]
+//              NUMOF(QueryKeys) if not found
+//
+static uint8_t FindKey(char *Name) {
+    uint8_t i;
+
+    for( i = 0; Name[i]; i++ )
+        Name[i] = tolower(Name[i]);
+
+    for( i = 0; i < NUMOF(QueryKeys); i++ )
+        if( strcmp_P(Name,QueryKeys[i].Name) == 0 )
+            break;
+
+    return i;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PrintKey - Print "key=value" for one key
+//
+// Inputs:      Index of key in QueryKeys[]
+//
+// Outputs:     None.
+//
+static void PrintKey(uint8_t Index) {
+    QUERY_KEY   Key;
+    uint16_t    Value;
+
+    memcpy_P(&Key,&QueryKeys[Index],sizeof(Key));
+
+    switch( Key.Type ) {
+        case KEY_BOOL:  Value = *(bool *) Key.Var;          break;
+        case KEY_RUN:   Value = SG3525_IS_ON ? 1 : 0;       break;
+        case KEY_FAULT: Value = FaultGet() - FAULT_NONE;    break;
+        case KEY_TEMP: {
+            int16_t Temp = ThermalGetTemp();
+
+            Value = Temp < 0 ? 0 : Temp;
+            break;
+            }
+        default:        Value = *(uint16_t *) Key.Var;      break;
+        }
+
+    PrintF("%s=%u",QueryKeys[Index].Name,Value);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueryGet - GET - Print one key, or all of them
+//
+// Inputs:      Key name, or "*"
+//
+// Outputs:     None.
+//
+static void QueryGet(char *Name) {
+    uint8_t Index;
+
+    if( strcmp(Name,"*") == 0 ) {
+        for( Index = 0; Index < NUMOF(QueryKeys); Index++ ) {
+            if( Index )
+                PrintChar(' ');
+            PrintKey(Index);
+            }
+        return;
+        }
+
+    Index = FindKey(Name);
+    if( Index == NUMOF(QueryKeys) ) {
+        PrintStringP(PSTR("ERR key"));
+        return;
+        }
+
+    PrintKey(Index);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QuerySet - SET - Set one key, and print it back
+//
+// Inputs:      "key=value" (changed by the parse)
+//
+// Outputs:     None.
+//
+static void QuerySet(char *Arg) {
+    QUERY_KEY   Key;
+    uint16_t    Value;
+    uint8_t     Index;
+    char       *ValueText = strchr(Arg,'=');
+
+    if( ValueText == NULL ) {
+        PrintStringP(PSTR("ERR syntax"));
+        return;
+        }
+    *ValueText++ = 0;
+
+    Index = FindKey(Arg);
+    if( Index == NUMOF(QueryKeys) ) {
+        PrintStringP(PSTR("ERR key"));
+        return;
+        }
+
+    memcpy_P(&Key,&QueryKeys[Index],sizeof(Key));
+
+    if( Key.Type != KEY_RW && Key.Type != KEY_RUN ) {
+        PrintStringP(PSTR("ERR readonly"));
+        return;
+        }
+
+    if( !ParseValue(ValueText,Key.Unit,&Value) || Value < Key.Min || Value > Key.Max ) {
+        PrintStringP(PSTR("ERR value"));
+        return;
+        }
+
+    //
+    // The staged commit (ST C) would overwrite a setpoint set now, at the next tick
+    //
+    if( Key.Type == KEY_RW && SG3525Staged() ) {
+        PrintStringP(PSTR("ERR staged"));
+        return;
+        }
+
+    if( Key.Type == KEY_RUN ) SG3525Run(Value);
+    else                      *(uint16_t *) Key.Var = Value;
+
+    PrintKey(Index);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueryExit - EXIT - Back to the console
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+static void QueryExit(void) {
+
+    QueryMode = false;
+    SerialSetMute(false);
+    PrintStringP(PSTR("mode=terminal\r\n"));
+    ShowScreen(QueryScreen);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueryLine - Process a line from the host, in machine mode
+//
+// Inputs:      Line from host, NUL terminated (changed by the parse)
+//
+// Outputs:     None.
+//
+// Output is muted between lines, and let through for the reply only.
+//
+void QueryLine(char *Line) {
+    char   *Argv[3];
+    uint8_t Argc = ParseArgs(Line,Argv,NUMOF(Argv));
+
+    if( Argc == 0 )
+        return;
+
+    if( Argc == 1 && StrEQ(Argv[0],"EXIT") ) {
+        QueryExit();
+        return;
+        }
+
+    SerialSetMute(false);
+
+    if     ( Argc == 2 && StrEQ(Argv[0],"GET") ) QueryGet(Argv[1]);
+    else if( Argc == 2 && StrEQ(Argv[0],"SET") ) QuerySet(Argv[1]);
+    else                                         PrintStringP(PSTR("ERR syntax"));
+
+    PrintCRLF();
+    SerialSetMute(true);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueryCmd - MM - Enter machine mode
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// Console output still queued is dropped, so that the host sees "mode=machine" soon
+//   after the echo, and nothing but replies after that.
+//
+void QueryCmd(uint8_t Argc,char *Argv[]) {
+
+    QueryScreen = SelectedScreen;
+    QueryMode   = true;
+
+    SerialFlushLo();
+    PrintStringP(PSTR("mode=machine\r\n"));
+    SerialSetMute(true);
+    }
@@ -0,0 +1,150 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Query.h - GET/SET line protocol, for host programs
+//
+//  SYNOPSIS
+//
+//      Cmd> MM                             // From the console: enter machine mode
+//      mode=machine                        // First line after the echo
+//
+//      GET freq                            // Host sends, no echo
+//      freq=28500                          // One line back, always
+//
+//      SET power=25.5W                     // Units as for the console (see Parse.h)
+//      power=255                           // Value as stored, in internal units
+//
+//      GET *                               // All keys, on one line
+//      freq=28500 power=255 run=0 timer=0 afreq=0 current=0 ...
+//
+//      SET apower=5                        // Errors are one line too
+//      ERR readonly
+//
+//      EXIT                                // Back to the console
+//      mode=terminal
+//
+//  DESCRIPTION
+//
+//      The console is for people: it echoes, prompts, and redraws the screen with
+//        VT100 escapes, and command replies land wherever the screen puts them. A
+//        host program would have to scrape all that.
+//
+//      Machine mode is for programs. Once in it, the unit sends nothing but replies
+//        to the host's lines (and telemetry frames, if subscribed, see Telemetry.h):
+//
+//          - No echo, no prompt, and no screen drawing or refresh.
+//          - Other text output (alarms, messages) is discarded.
+//          - Each line in gets exactly one line out, "key=value ..." or "ERR why",
+//            ending in CR LF, with no escape sequences.
+//
+//      Lines in may end in CR, LF, or both. Empty lines are ignored, so CR LF
+//        still gets one reply.
+//
+//      Keys are in lower case (either case is accepted), and values are unsigned
+//        decimal in internal units. SET checks the value against the key's range,
+//        and replies with the value read back after setting, so "SET run=1" with
+//        a fault latched replies "run=0".
+//
+//  KEYS
+//
+//      freq        RW  Target frequency, Hz
+//      power       RW  Target power, watts x 10
+//      run         RW  Transducer output, 1 on, 0 off
+//      timer       RW  Run timer, ticks (for MO RT)
+//      afreq       RO  Actual frequency, Hz
+//      current     RO  Current, amps x 10
+//      apower      RO  Actual power, watts x 10
+//      vcc         RO  Vcc, volts x 10
+//      vc          RO  Vc, volts x 10
+//      pwm         RO  PWM, % x 10
+//      temp        RO  Board temperature, deg C (0 if below zero)
+//      fault       RO  Latched fault: 0 none, 1 open, 2 short, 3 lock, 4 brownout, 5 hot
+//      locked      RO  Frequency lock, 1 locked, 0 not
+//      acquire     RO  Ticks taken by the last lock acquisition
+//
+//  ERRORS
+//
+//      ERR syntax      Not GET, SET or EXIT, or no "=" in a SET
+//      ERR key         No such key
+//      ERR value       Bad number, or out of range for the key
+//      ERR readonly    Key can't be SET
+//      ERR staged      Setpoint change staged at the console (ST)
+//
+//  LATENCY
+//
+//      A line is handled as soon as its CR is read, between ticks, so a request
+//        waits at most for one pass of the tick's work (the screen is off in machine
+//        mode). The reply is queued at once, in front of nothing but earlier replies.
+//
+//      The reply then takes its length in char times to go out, after any
+//        telemetry frame already started: at 19200 baud, about 6 ms for
+//        "freq=28500", and 90 ms for "GET *". "GET *" is longer than the reply
+//        queue, and fits only because part of it moves on to the UART's Tx FIFO.
+//        Output never waits for room, so if a telemetry frame is still filling
+//        that FIFO, the reply is cut short and a '~' marks the gap.
+//
+//      One request at a time is the simplest way to drive it: send a line, read
+//        a line.
+//
+//  VERSION:    2015.08.28
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+extern bool QueryMode;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueryLine - Process a line from the host, in machine mode
+//
+// Inputs:      Line from host, NUL terminated (changed by the parse)
+//
+// Outputs:     None.
+//
+void QueryLine(char *Line);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueryCmd - MM - Enter machine mode
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+void QueryCmd(uint8_t Argc,char *Argv[]);
+
+#endif  // QUERY_H - entire file
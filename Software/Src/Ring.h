@@ -0,0 +1,122 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Ring.h - Single producer, single consumer ring buffer
+//
+//  SYNOPSIS
+//
+//      static RING_T(char,16) Fifo NOINIT;     // 16 chars, power of two, max 256
+//
+//      RING_INIT(Fifo);                        // Empty the ring
+//
+//      if( !RING_FULL(Fifo) )                  // Producer side
+//          RING_PUT(Fifo,Char);
+//
+//      if( !RING_EMPTY(Fifo) ) {               // Consumer side
+//          Char = RING_PEEK(Fifo);
+//          RING_SKIP(Fifo);
+//          }
+//
+//      RING_COUNT(Fifo)                        // Number of elements in ring
+//      RING_FREE(Fifo)                         // Number of free elements
+//
+//  DESCRIPTION
+//
+//      A ring of elements, with one side (such as an ISR) adding elements and the
+//        other side (such as the main loop) removing them.
+//
+//      The indices are single bytes, which the AVR reads and writes atomically. The
+//        producer only ever writes In and the consumer only ever writes Out, and
+//        each side publishes its index only after the element is in place, so
+//        neither side needs to disable interrupts around the ring.
+//
+//      The size is fixed at compile time, and must be a power of two no larger than
+//        256. Anything else is a compile error. One element is left unused, to tell
+//        a full ring from an empty one.
+//
+//      Each side may look at the other's index (to check for room or for data),
+//        but must not write it.
+//
+//  VERSION:    2015.08.24
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+
+#include "PortMacros.h"
+
+//
+// RING_T - Ring type of _size_ elements of _type_
+//
+// The unnamed bitfield takes no space, but has a negative width (a compile error) if
+//   the size is not a power of two from 2 to 256. The buffer comes first, so the ring
+//   takes the alignment of the buffer.
+//
+#define RING_T(_type_,_size_)                                                       \
+    struct {                                                                        \
+        _type_              Buf[_size_];                                            \
+        volatile uint8_t    In;             /* Written only by producer */          \
+        volatile uint8_t    Out;            /* Written only by consumer */          \
+        uint8_t             :(((_size_) & ((_size_)-1)) || (_size_) < 2 ||          \
+                              (_size_) > 256 ? -1 : 0);                             \
+        }
+
+//
+// RING_BARRIER - Keep the compiler from moving element accesses past an index update
+//
+#define RING_BARRIER        __asm__ __volatile__ ("" ::: "memory")
+
+#define RING_WRAP(_r_)      ((uint8_t) (NUMOF((_r_).Buf)-1))
+#define RING_NEXT(_r_,_i_)  ((uint8_t) ((_i_)+1) & RING_WRAP(_r_))
+
+#define RING_INIT(_r_)      { (_r_).In = 0; (_r_).Out = 0; }
+
+#define RING_EMPTY(_r_)     ((_r_).In == (_r_).Out)
+#define RING_FULL(_r_)      (RING_NEXT(_r_,(_r_).In) == (_r_).Out)
+#define RING_COUNT(_r_)     ((uint8_t) ((_r_).In  - (_r_).Out    ) & RING_WRAP(_r_))
+#define RING_FREE(_r_)      ((uint8_t) ((_r_).Out - (_r_).In  - 1) & RING_WRAP(_r_))
+
+//
+// Producer side. Check RING_FULL() (or RING_FREE()) first.
+//
+#define RING_PUT(_r_,_x_)   { (_r_).Buf[(_r_).In] = (_x_);                          \
+                              RING_BARRIER;                                         \
+                              (_r_).In = RING_NEXT(_r_,(_r_).In); }
+
+//
+// Consumer side. Check RING_EMPTY() (or RING_COUNT()) first.
+//
+#define RING_PEEK(_r_)      ((_r_).Buf[(_r_).Out])
+#define RING_SKIP(_r_)      { RING_BARRIER;                                         \
+                              (_r_).Out = RING_NEXT(_r_,(_r_).Out); }
+
+#endif  // RING_H - entire file
@@ -41,6 +41,8 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 
+#include <string.h>
+
 #include "SG3525.h"
 #include "PWM.h"
 #include "Freq.h"
@@ -49,6 +51,10 @@
 #include "Outputs.h"
 #include "SPIInline.h"
 #include "Serial.h"
+#include "Fault.h"
+#include "ADC.h"
+#include "Supply.h"
+#include "Thermal.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -59,7 +65,17 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 
 SG3525_SET  SG3525Set  NOINIT;
+SG3525_SET  SG3525Stage NOINIT;
 SG3525_CURR SG3525Curr NOINIT;
+SG3525_LOCK SG3525Lock NOINIT;
+
+static bool PWMLimited;                 // TRUE if pot is being held below PWMWiper
+
+static enum {
+    STAGE_NONE = 0,                     // Commands change SG3525Set
+    STAGE_OPEN,                         // Commands change SG3525Stage
+    STAGE_COMMIT,                       // Same, and SG3525Stage goes in next update
+    } StageState;
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -84,15 +100,20 @@ void SG3525Init(void) {
     FreqFPotInit;
     FreqInit();
     PWMInit();
+    ADCInit();
     ACS712Init();
+    SupplyInit();
+    ThermalInit();
     InputsInit();
     OutputsInit();
+    FaultInit();
 //    BuzzerInit();
 
     SG3525Set.Freq      = SG3525_DEF_FREQ;
     SG3525Set.Power     = SG3525_MIN_POWER;
     SG3525Set.RunMode   = RUN_CONTINUOUS;
     SG3525Set.RunTimer  = 0;
+    StageState          = STAGE_NONE;
 
     SG3525Curr.RunTimer = 0;
     SG3525Curr.Freq     = 0;
@@ -102,7 +123,10 @@ void SG3525Init(void) {
     SG3525Curr.Vc       = 0;
     SG3525Curr.PWM      = 0;
 
+    memset(&SG3525Lock,0,sizeof(SG3525Lock));
+
     SG3525Curr.PWMWiper   = 30;
+    SG3525Curr.PWMLimit   = PWMPot_MAX_WIPER;
     SG3525Curr.FreqCWiper = FreqCPot_MAX_WIPER/2+3;
     SG3525Curr.FreqFWiper = FreqFPot_MAX_WIPER/2;
 
@@ -124,8 +148,13 @@ void SG3525Init(void) {
 // NOTE: If SG3525Curr.RunMode == MODE_TIMED, will set timer and turn off output
 //         when timer expires
 //
+// NOTE: Output will not be enabled while a fault is holding it off
+//
 void SG3525Run(bool Run) {
 
+    if( Run && FaultStopped() )
+        Run = false;
+
     if( Run ) {
         if( SG3525Set.RunMode == RUN_TIMED )
             SG3525Curr.RunTimer = SG3525Set.RunTimer;
@@ -138,6 +167,85 @@ void SG3525Run(bool Run) {
     }
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525SetPWM - Send the PWM wiper to the pot, held to the protection limit
+//
+// Inputs:      None. (Sends SG3525Curr.PWMWiper, at most SG3525Curr.PWMLimit)
+//
+// Outputs:     None.
+//
+// The limit is applied to the pot only, so that the wiper setting is restored once
+//   the limit is lifted.
+//
+void SG3525SetPWM(void) {
+
+    if( SG3525Curr.PWMWiper > SG3525Curr.PWMLimit ) {
+        PWMPotSetWiper(SG3525Curr.PWMLimit);
+        PWMLimited = true;
+        }
+    else {
+        PWMPotSetWiper(SG3525Curr.PWMWiper);
+        PWMLimited = false;
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525Begin  - Start staging, from the current settings
+// SG3525Commit - Apply the staged settings, at the start of the next update
+// SG3525Abort  - Drop the staged settings
+// SG3525Staged - Return TRUE while staging, or with a commit not yet applied
+//
+// Inputs:      None.
+//
+// Outputs:     (SG3525Staged) TRUE if staged, FALSE otherwise
+//
+// Begin while already staged keeps what has been staged so far.
+//
+void SG3525Begin(void) {
+
+    if( StageState == STAGE_NONE )
+        SG3525Stage = SG3525Set;
+    StageState = STAGE_OPEN;
+    }
+
+void SG3525Commit(void) { StageState = STAGE_COMMIT; }
+void SG3525Abort(void)  { StageState = STAGE_NONE;   }
+bool SG3525Staged(void) { return StageState != STAGE_NONE; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525Edit    - Return the settings that commands should change
+// SG3525EditVar - Return the setting that commands should change, by address
+//
+// Inputs:      (SG3525EditVar) Address of a variable, in SG3525Set or not
+//
+// Outputs:     SG3525Stage (or the variable in it) while staged, SG3525Set otherwise
+//
+// Changes made after ST C but before the next update still go into the commit, so
+//   that the commit doesn't undo them.
+//
+SG3525_SET *SG3525Edit(void) {
+
+    return StageState == STAGE_NONE ? &SG3525Set : &SG3525Stage;
+    }
+
+void *SG3525EditVar(void *Var) {
+    int16_t Offset = (char *) Var - (char *) &SG3525Set;
+
+    if( StageState == STAGE_NONE || Offset < 0 || Offset >= (int16_t) sizeof(SG3525Set) )
+        return Var;
+
+    return (char *) &SG3525Stage + Offset;
+    }
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -258,6 +366,72 @@ static void SG3525AdjustPower(void) {
         }
     }
 #endif
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525LockUpdate - Track frequency lock, and lock acquisition times
+//
+// Inputs:      None. Called periodically by the update program
+//
+// Outputs:     None.
+//
+static void SG3525LockUpdate(void) {
+    uint16_t FreqErr;
+    uint8_t  Bucket;
+    uint16_t Ticks;
+
+    //
+    // Turning off, or moving the setpoint, starts a new acquisition
+    //
+    if( !SG3525_IS_ON || SG3525Lock.Freq != SG3525Set.Freq ) {
+        SG3525Lock.Locked = false;
+        SG3525Lock.Freq   = SG3525Set.Freq;
+        SG3525Lock.Dwell  = 0;
+        SG3525Lock.Ticks  = 0;
+        return;
+        }
+
+    if( SG3525Lock.Ticks < 0xFFFF )
+        SG3525Lock.Ticks++;
+
+    FreqErr = SG3525Curr.Freq > SG3525Set.Freq ? SG3525Curr.Freq - SG3525Set.Freq
+                                               : SG3525Set.Freq - SG3525Curr.Freq;
+
+    if( SG3525Lock.Locked ) {
+        if( FreqErr > SG3525_LOCK_EXIT_HZ ) {
+            SG3525Lock.Locked = false;
+            SG3525Lock.Dwell  = 0;
+            SG3525Lock.Ticks  = 0;
+            }
+        return;
+        }
+
+    if( FreqErr > SG3525_LOCK_ENTER_HZ ) {
+        SG3525Lock.Dwell = 0;
+        return;
+        }
+
+    if( ++SG3525Lock.Dwell < SG3525_LOCK_DWELL )
+        return;
+
+    //
+    // Locked. Record how long it took, and bin it into the histogram.
+    //
+    SG3525Lock.Locked       = true;
+    SG3525Lock.AcquireTicks = SG3525Lock.Ticks;
+    SG3525Lock.Ticks        = 0;
+
+    if( SG3525Lock.Acquisitions < 0xFFFF )
+        SG3525Lock.Acquisitions++;
+
+    for( Bucket = 0, Ticks = SG3525Lock.AcquireTicks;
+         Ticks > 1 && Bucket < SG3525_LOCK_BUCKETS-1; Bucket++ )
+        Ticks >>= 1;
+
+    if( SG3525Lock.Hist[Bucket] < 0xFFFF )
+        SG3525Lock.Hist[Bucket]++;
+    }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -270,12 +444,21 @@ static void SG3525AdjustPower(void) {
 //
 void SG3525Update(void) {
 
+    //
+    // Staged settings go in first, all at once, before anything looks at them
+    //
+    if( StageState == STAGE_COMMIT ) {
+        SG3525Set  = SG3525Stage;
+        StageState = STAGE_NONE;
+        }
+
     //
     // Update all subordinate components
     //
     FreqUpdate();
     PWMUpdate();
-    ACS712Update();
+    ADCUpdate();
+    ACS712Update(!SG3525_IS_ON);
     InputsUpdate();
 
     //
@@ -288,9 +471,31 @@ void SG3525Update(void) {
     if( SG3525_IS_ON ) SG3525Curr.Freq = GetPWMFreq();
     else               SG3525Curr.Freq = GetFreq() >> 1;
 
+    SG3525LockUpdate();
+
     SG3525Curr.PWM     = GetPWM();
     SG3525Curr.Current = ACS712GetCurrent();
-    SG3525Curr.Power   = SG3525Curr.Current*12;
+    SG3525Curr.Vcc     = SupplyGetVcc();
+
+    if( (int16_t) SG3525Curr.Current > 0 )
+        SG3525Curr.Power = (((uint32_t) SG3525Curr.Current)*SG3525Curr.Vcc)/10;
+    else
+        SG3525Curr.Power = 0;
+
+    //
+    // Protect the supply and the board, and check for transducer faults. Any of these
+    //   may turn us off or limit the PWM.
+    //
+    // The limit is applied to the pot only, so that the wiper setting is restored
+    //   once the limit is lifted.
+    //
+    SG3525Curr.PWMLimit = PWMPot_MAX_WIPER;
+    SupplyUpdate();
+    ThermalUpdate();
+    FaultUpdate();
+
+    if( SG3525Curr.PWMWiper > SG3525Curr.PWMLimit || PWMLimited )
+        SG3525SetPWM();
 
     //
     // If we're running on timer, decrement and possibly stop
@@ -112,6 +112,16 @@
 // Uncomment this to print single-chars that show the power tuning
 //
 #define SHOW_PWR_TUNING
+
+//
+// Lock detector: Locked once within ENTER_HZ of the setpoint for DWELL ticks, and
+//   unlocked when the error grows past EXIT_HZ.
+//
+#define SG3525_LOCK_ENTER_HZ    20
+#define SG3525_LOCK_EXIT_HZ     50
+#define SG3525_LOCK_DWELL       5           // Ticks, ~200 ms
+
+#define SG3525_LOCK_BUCKETS     8           // Histogram buckets: 1, 2, 4, ... 128+ ticks
 
 
 //
@@ -178,9 +188,10 @@ typedef enum {
     INPUT_XCTRL,            // Xducer control: on while pushed
     INPUT_XPOPO,            // Xducer control: Push on/push off
     INPUT_ESTOP,            // ESTOP when triggered
+    INPUT_MACRO,            // Run macro I1 or I2 when triggered
     } INPUT_ACTION;
 
-#define NUM_ACTIONS     ( INPUT_ESTOP - INPUT_UNUSED + 1 )
+#define NUM_ACTIONS     ( INPUT_MACRO - INPUT_UNUSED + 1 )
 #define IDX_ACTION(_x_) (_x_ - INPUT_UNUSED)            // Index of 1st input action
 
 typedef struct {
@@ -209,6 +220,15 @@ typedef struct {
 
 extern SG3525_SET SG3525Set;
 
+//
+// SG3525Stage - Settings staged by ST, to be committed to SG3525Set in one piece
+//
+// While staging, settings commands change SG3525Stage instead of SG3525Set (see
+//   SG3525Edit()). ST C swaps the whole of it in at the start of the next
+//   SG3525Update(), so a tick never runs with some settings changed and not others.
+//
+extern SG3525_SET SG3525Stage;
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 // SG3525Curr - Actual current parameters, measured by the SG3525 module
@@ -227,11 +247,32 @@ typedef struct {
     uint16_t    PWM;        // PWM, in     % x 10
 
     uint16_t    PWMWiper;   // Current PWM         wiper
+    uint16_t    PWMLimit;   // Max     PWM         wiper, set by protection
     uint16_t    FreqCWiper; // Current coarse freq wiper
     uint16_t    FreqFWiper; // Current fine   freq wiper
     } SG3525_CURR;
 
 extern SG3525_CURR SG3525Curr;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525Lock - Frequency lock detector, updated by the SG3525 module
+//
+// Acquisition times (ticks from output on or setpoint change, until locked) are kept
+//   in a log2 histogram: bucket N counts times of 2^N to 2^(N+1)-1 ticks, and the last
+//   bucket counts everything longer.
+//
+typedef struct {
+    bool        Locked;             // TRUE if frequency is locked
+    uint16_t    Freq;               // Setpoint being locked to
+    uint8_t     Dwell;              // Ticks within ENTER_HZ, while acquiring
+    uint16_t    Ticks;              // Ticks acquiring (unlocked), or held (locked)
+    uint16_t    AcquireTicks;       // Ticks taken by last acquisition
+    uint16_t    Acquisitions;       // Number of acquisitions
+    uint16_t    Hist[SG3525_LOCK_BUCKETS];
+    } SG3525_LOCK;
+
+extern SG3525_LOCK SG3525Lock;
 
 //
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -316,6 +357,55 @@ void SG3525Init(void);
 void SG3525Run(bool Run);
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525SetPWM - Send the PWM wiper to the pot, held to the protection limit
+//
+// Inputs:      None. (Sends SG3525Curr.PWMWiper, at most SG3525Curr.PWMLimit)
+//
+// Outputs:     None.
+//
+// Anything that changes SG3525Curr.PWMWiper sends it with this, so that no path
+//   gets around a supply, thermal, or derate limit.
+//
+void SG3525SetPWM(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525Begin  - Start staging, from the current settings
+// SG3525Commit - Apply the staged settings, at the start of the next update
+// SG3525Abort  - Drop the staged settings
+// SG3525Staged - Return TRUE while staging, or with a commit not yet applied
+//
+// Inputs:      None.
+//
+// Outputs:     (SG3525Staged) TRUE if staged, FALSE otherwise
+//
+void SG3525Begin(void);
+void SG3525Commit(void);
+void SG3525Abort(void);
+bool SG3525Staged(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525Edit    - Return the settings that commands should change
+// SG3525EditVar - Return the setting that commands should change, by address
+//
+// Inputs:      (SG3525EditVar) Address of a variable, in SG3525Set or not
+//
+// Outputs:     SG3525Stage (or the variable in it) while staged, SG3525Set otherwise
+//
+// A variable outside SG3525Set is returned as is.
+//
+SG3525_SET *SG3525Edit(void);
+void       *SG3525EditVar(void *Var);
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -343,14 +433,31 @@ void SG3525AdjustFreq(void);
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// SG3525Cmd - Manage typed commands aimed at the SG3525 system
+// SG3525xxCmd - Typed commands aimed at the SG3525 system
 //
-// Inputs:      None.
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
 //
-// Outputs:     TRUE  if we understood and processed command
-//              FALSE if command isn't ours, belongs to another subsystem
+// Outputs:     None.
 //
-bool SG3525Cmd(char *Command);
+// Called from the command table in Command.c
+//
+void SG3525OffCmd(uint8_t Argc,char *Argv[]);           // OF, and ESC on the main screen
+void SG3525OnCmd(uint8_t Argc,char *Argv[]);            // ON
+void SG3525XXCmd(uint8_t Argc,char *Argv[]);            // XX
+void SG3525ZeroCmd(uint8_t Argc,char *Argv[]);          // AZ
+void SG3525GainCmd(uint8_t Argc,char *Argv[]);          // AG
+void SG3525TempCmd(uint8_t Argc,char *Argv[]);          // TC
+void SG3525LockCmd(uint8_t Argc,char *Argv[]);          // LK
+void SG3525StageCmd(uint8_t Argc,char *Argv[]);         // ST
+
+#ifdef USE_ADJ_CMDS
+void SG3525AdjCmd(uint8_t Argc,char *Argv[]);           // U, D, W, N, +, -
+#endif
+
+#ifdef USE_WIPER_CMDS
+void SG3525WiperCmd(uint8_t Argc,char *Argv[]);         // FCW, FFW, PW
+#endif
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -106,7 +106,7 @@ void SG3525Cal(void) {
         //
         case WAIT_START:
             SG3525Curr.PWMWiper = 30;
-            PWMPotSetWiper(SG3525Curr.PWMWiper);
+            SG3525SetPWM();
             SG3525Set.Freq = CAL_FREQ;
             SG3525AdjustFreq();
             CalStep = WAIT_28K;
@@ -175,7 +175,7 @@ PrintCRLF();
             //
             for( uint8_t i=0; i<20; i++ )
                 PrintCRLF();
-            ShowMAScreen();
+            ShowScreen('MA');
             break;
         }
 
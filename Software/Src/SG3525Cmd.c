@@ -43,6 +43,7 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "SG3525.h"
 
@@ -52,6 +53,11 @@
 #include "Inputs.h"
 #include "EEPROM.h"
 #include "MAScreen.h"
+#include "Fault.h"
+#include "ACS712.h"
+#include "Thermal.h"
+#include "Timer.h"
+#include "Macro.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -64,249 +70,289 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// SG3525Cmd - Manage typed commands aimed at the SG3525 system
+// SG3525OffCmd - OF - Turn transducer output off
 //
-// Inputs:      Command to interpret
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
 //
-// Outputs:     TRUE  if we understood and processed command
-//              FALSE if command isn't ours, belongs to another system
+// Outputs:     None.
 //
-bool SG3525Cmd(char *Command) {
-
-    //
-    // OFF - Turn transducer output off
-    //
-    if( StrEQ(Command,"OF" ) ||
-        StrEQ(Command,ESC_CMD)) {
-        SG3525Run(false);
-StartMsg();
-PrintStringP(PSTR("Transducer OFF"));
-        return true;
-        }
+// Also ESC, on the main screen.
+//
+void SG3525OffCmd(uint8_t Argc,char *Argv[]) {
 
+    SG3525Run(false);
+    StartMsg();
+    PrintStringP(PSTR("Transducer OFF"));
+    }
 
-    //
-    // ON - Turn transducer output on
-    //
-    if( StrEQ(Command,"ON") ) {
-        SG3525Run(true);
-StartMsg();
-PrintStringP(PSTR("Transducer ON"));
-        return true;
-        }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525OnCmd - ON - Turn transducer output on
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+void SG3525OnCmd(uint8_t Argc,char *Argv[]) {
 
-    //
-    // XX - Special debug command
-    //
-    if( StrEQ(Command,"XX" ) ) {
-        return true;
-        }
+    SG3525Run(true);
+    StartMsg();
+    if( FaultStopped() ) PrintStringP(PSTR("Transducer held OFF by fault (FA C to clear)"));
+    else                 PrintStringP(PSTR("Transducer ON"));
+    }
 
 
-    //
-    // FR - Set frequency
-    //
-    if( StrEQ(Command,"FR") ) {
-        char *FreqText = ParseToken();
-        int   FreqNum  = atoi(FreqText);
-        if( FreqNum < SG3525_MIN_FREQ ||
-            FreqNum > SG3525_MAX_FREQ ) {
-            StartMsg();
-            PrintStringP(PSTR("Bad or out of range frequency ("));
-            PrintString(FreqText);
-            PrintStringP(PSTR("), must be "));
-            PrintD(SG3525_MIN_FREQ,0);
-            PrintStringP(PSTR(" to "));
-            PrintD(SG3525_MAX_FREQ,0);
-            PrintCRLF();
-            PrintStringP(PSTR("Type '?' for help\r\n"));
-            return true;
-            }
-
-        SG3525Set.Freq = FreqNum;
-        return true;
-        }
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525XXCmd - XX - Special debug command
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+void SG3525XXCmd(uint8_t Argc,char *Argv[]) {
+    }
 
-    //
-    // PO - Set power
-    //
-    if( StrEQ(Command,"PO") ) {
-        char *PowerText = ParseToken();
-        int   PowerNum  = atoi(PowerText);
-        if( PowerNum < SG3525_MIN_POWER ||
-            PowerNum > SG3525_MAX_POWER ) {
-            StartMsg();
-            PrintStringP(PSTR("Bad or out of range power ("));
-            PrintString(PowerText);
-            PrintStringP(PSTR("), must be "));
-            PrintD(SG3525_MIN_POWER,0);
-            PrintStringP(PSTR(" to "));
-            PrintD(SG3525_MAX_POWER,0);
-            PrintCRLF();
-            PrintStringP(PSTR("Type '?' for help\r\n"));
-            return true;
-            }
-
-        SG3525Set.Power = PowerNum;
-        return true;
-        }
 
-#ifdef USE_ADJ_CMDS
-    //////////////////////////////////////////////////////////////////////////////////////
-    //
-    // ADJ COMMANDS
-    //
-    // For debugging, allow the user to directly bump the power/freq
-    //
-
-    //
-    // U - Bump the frequency up 1 notch
-    //
-    if( StrEQ(Command,"U" ) ) {
-        FreqCPotSetWiper(++SG3525Curr.FreqCWiper);
-//        SG3525SetFreq(SG3525Set.Freq+1);
-        return true;
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525ZeroCmd - AZ - Re-zero the current sensor
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+void SG3525ZeroCmd(uint8_t Argc,char *Argv[]) {
+
+    StartMsg();
+    if( SG3525_IS_ON ) {
+        PrintStringP(PSTR("Turn transducer OFF to re-zero current sensor"));
+        return;
         }
 
+    ACS712Zero();
+    PrintStringP(PSTR("Zero "));
+    PrintD(EEPROM.ACS712Cal.Zero,0);
+    PrintStringP(PSTR(", gain "));
+    PrintD(EEPROM.ACS712Cal.Gain,0);
+    PrintStringP(PSTR(", re-zeroing"));
+    }
 
-    //
-    // D - Bump the frequency down 1 notch
-    //
-    if( StrEQ(Command,"D" ) ) {
-        FreqCPotSetWiper(--SG3525Curr.FreqCWiper);
-//        SG3525SetFreq(SG3525Set.Freq-1);
-        return true;
-        }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525GainCmd - AG - Set current gain, from known current
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// The current (amps x 10) has already been range checked by the command table.
+//
+void SG3525GainCmd(uint8_t Argc,char *Argv[]) {
+    uint16_t CurrNum;
+
+    ParseNum(Argv[1],&CurrNum);
 
-    //
-    // W - Make PWM wider
-    //
-    if( StrEQ(Command,"W" ) ) {
-        PWMPotSetWiper(++SG3525Curr.PWMWiper);
-//        SG3525SetPower(SG3525Set.Power+1);
-        return true;
+    if( !ACS712SetGain(CurrNum) ) {
+        StartMsg();
+        PrintStringP(PSTR("No current flowing, turn transducer ON first"));
+        return;
         }
 
+    StartMsg();
+    PrintStringP(PSTR("Current gain "));
+    PrintD(EEPROM.ACS712Cal.Gain,0);
+    }
 
-    //
-    // N - Make PWM narrower
-    //
-    if( StrEQ(Command,"N" ) ) {
-        PWMPotSetWiper(--SG3525Curr.PWMWiper);
-//        SG3525SetPower(SG3525Set.Power-1);
-        return true;
-        }
 
-    //
-    // + - Make frequency go up by a little
-    //
-    if( StrEQ(Command,"+" ) ) {
-        FreqFPotSetWiper(++SG3525Curr.FreqFWiper);
-//        SG3525SetPower(SG3525Set.Power+1);
-        return true;
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525TempCmd - TC - Calibrate board temperature, from known temperature
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// The temperature has already been range checked by the command table.
+//
+void SG3525TempCmd(uint8_t Argc,char *Argv[]) {
+    uint16_t TempNum;
+
+    ParseNum(Argv[1],&TempNum);
+
+    if( !ThermalSetTemp(TempNum) ) {
+        StartMsg();
+        PrintStringP(PSTR("No temperature reading yet, try again in a second"));
+        return;
         }
 
+    StartMsg();
+    PrintStringP(PSTR("Temperature offset "));
+    PrintD(EEPROM.ThermalCal.Offset,0);
+    }
+
 
-    //
-    // - - Make frequency go down by a little
-    //
-    if( StrEQ(Command,"-" ) ) {
-        FreqFPotSetWiper(--SG3525Curr.FreqFWiper);
-//        SG3525SetPower(SG3525Set.Power-1);
-        return true;
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525LockCmd - LK - Show frequency lock status and acquisition histogram
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// LK C clears the lock statistics.
+//
+void SG3525LockCmd(uint8_t Argc,char *Argv[]) {
+    char *LockText = Argv[1];
+
+    if( StrEQ(LockText,"C") ) {
+        SG3525Lock.AcquireTicks = 0;
+        SG3525Lock.Acquisitions = 0;
+        memset(SG3525Lock.Hist,0,sizeof(SG3525Lock.Hist));
+        StartMsg();
+        PrintStringP(PSTR("Lock stats cleared"));
+        return;
+        }
+
+    StartMsg();
+    PrintStringP(SG3525Lock.Locked ? PSTR("Locked") : PSTR("Not locked"));
+    PrintStringP(PSTR(", last acquire "));
+    PrintD(SG3525Lock.AcquireTicks < 0xFFFF/MS_PER_TICK ?
+           SG3525Lock.AcquireTicks*MS_PER_TICK : 0xFFFF,0);
+    PrintStringP(PSTR(" ms, "));
+    PrintD(SG3525Lock.Acquisitions,0);
+    PrintStringP(PSTR(" acquisitions\r\n"));
+
+    for( uint8_t i = 0; i < SG3525_LOCK_BUCKETS; i++ ) {
+        PrintStringP(PSTR(">="));
+        PrintD((1 << i)*MS_PER_TICK,5);
+        PrintStringP(PSTR(" ms: "));
+        PrintD(SG3525Lock.Hist[i],0);
+        PrintCRLF();
         }
+    }
 
-#endif // USE_ADJ_CMDS
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525StageCmd - ST - Stage settings, and commit or abort them
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// ST starts staging: FR, PO, MO and LS then change the staged settings only. ST C
+//   commits them all at the next tick, and ST A throws them away.
+//
+void SG3525StageCmd(uint8_t Argc,char *Argv[]) {
+    char *StageText = Argv[1];
+
+    StartMsg();
 
-#ifdef USE_WIPER_CMDS
-    //////////////////////////////////////////////////////////////////////////////////////
-    //
-    // WIPER COMMANDS
-    //
-    // For debugging, allow the user to directly set the wiper positions
-    //
-
-    //
-    // FCW - Set frequency coarse wiper
-    //
-    if( StrEQ(Command,"FCW") ) {
-        char *FreqText = ParseToken();
-        int   FreqNum  = atoi(FreqText);
-        if( FreqNum < 0 ||
-            FreqNum > FreqCPot_MAX_WIPER ) {
-            StartMsg();
-            PrintStringP(PSTR("Bad or out of range wiper ("));
-            PrintString(FreqText);
-            PrintStringP(PSTR("), must be 0 to "));
-            PrintD(FreqCPot_MAX_WIPER,0);
-            PrintCRLF();
-            PrintStringP(PSTR("Type '?' for help\r\n"));
-            PrintCRLF();
-            return true;
-            }
-
-        SG3525Curr.FreqCWiper = FreqNum;
-        FreqCPotSetWiper(SG3525Curr.FreqCWiper);
-        return true;
+    if( StageText[0] == 0 ) {
+        SG3525Begin();
+        PrintStringP(PSTR("Staging, ST C to commit or ST A to abort"));
+        return;
         }
 
+    if( !SG3525Staged() ) {
+        PrintStringP(PSTR("Nothing staged, ST to start"));
+        return;
+        }
 
-    //
-    // FFW - Set frequency fine wiper
-    //
-    if( StrEQ(Command,"FFW") ) {
-        char *FreqText = ParseToken();
-        int   FreqNum  = atoi(FreqText);
-        if( FreqNum < 0 ||
-            FreqNum > FreqFPot_MAX_WIPER ) {
-            StartMsg();
-            PrintStringP(PSTR("Bad or out of range wiper ("));
-            PrintString(FreqText);
-            PrintStringP(PSTR("), must be 0 to "));
-            PrintD(FreqFPot_MAX_WIPER,0);
-            PrintCRLF();
-            PrintStringP(PSTR("Type '?' for help\r\n"));
-            PrintCRLF();
-            return true;
-            }
-
-        SG3525Curr.FreqFWiper = FreqNum;
-        FreqFPotSetWiper(SG3525Curr.FreqCWiper);
-        return true;
+    if( StrEQ(StageText,"C") ) {
+        SG3525Commit();
+        PrintStringP(PSTR("Staged settings committed"));
+        return;
         }
 
+    if( StrEQ(StageText,"A") ) {
+        SG3525Abort();
+        PrintStringP(PSTR("Staged settings dropped"));
+        return;
+        }
 
-    //
-    // PW - Set transducer power wiper
-    //
-    if( StrEQ(Command,"PW") ) {
-        char *PowerText = ParseToken();
-        int   PowerNum  = atoi(PowerText);
-        if( PowerNum < 0 ||
-            PowerNum > PWMPot_MAX_WIPER ) {
-            StartMsg();
-            PrintStringP(PSTR("Bad or out of range wiper ("));
-            PrintString(PowerText);
-            PrintStringP(PSTR("), must be 0 to "));
-            PrintD(PWMPot_MAX_WIPER,0);
-            PrintCRLF();
-            PrintStringP(PSTR("Type '?' for help\r\n"));
-            PrintCRLF();
-            return true;
-            }
-
-        SG3525Curr.PWMWiper = PowerNum;
-        PWMPotSetWiper(SG3525Curr.PWMWiper);
-        return true;
+    PrintStringP(PSTR("Unrecognized stage argument ("));
+    PrintString(StageText);
+    PrintStringP(PSTR("), must be C, A or nothing\r\n"));
+    PrintStringP(PSTR("Type '?' for help\r\n"));
+    }
+
+
+#ifdef USE_ADJ_CMDS
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525AdjCmd - Bump the wipers one notch
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// For debugging, allow the user to directly bump the power/freq
+//
+//      U - Bump the frequency up 1 notch
+//      D - Bump the frequency down 1 notch
+//      W - Make PWM wider
+//      N - Make PWM narrower
+//      + - Make frequency go up by a little
+//      - - Make frequency go down by a little
+//
+void SG3525AdjCmd(uint8_t Argc,char *Argv[]) {
+
+    switch( Argv[0][0] ) {
+        case 'U': FreqCPotSetWiper(++SG3525Curr.FreqCWiper); break;
+        case 'D': FreqCPotSetWiper(--SG3525Curr.FreqCWiper); break;
+        case 'W': ++SG3525Curr.PWMWiper; SG3525SetPWM();    break;
+        case 'N': --SG3525Curr.PWMWiper; SG3525SetPWM();    break;
+        case '+': FreqFPotSetWiper(++SG3525Curr.FreqFWiper); break;
+        case '-': FreqFPotSetWiper(--SG3525Curr.FreqFWiper); break;
         }
-#endif // USE_WIPER_CMDS
+    }
+#endif // USE_ADJ_CMDS
 
 
-    return false;
+#ifdef USE_WIPER_CMDS
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SG3525WiperCmd - FCW, FFW, PW - Set a wiper position
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// For debugging, allow the user to directly set the wiper positions. The command
+//   table has already checked and stored the new position, so all that's left is to
+//   send the wipers out. All three are sent, which is cheap and needs no case for
+//   which one changed.
+//
+void SG3525WiperCmd(uint8_t Argc,char *Argv[]) {
+
+    FreqCPotSetWiper(SG3525Curr.FreqCWiper);
+    FreqFPotSetWiper(SG3525Curr.FreqFWiper);
+    SG3525SetPWM();
     }
+#endif // USE_WIPER_CMDS
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -358,6 +404,14 @@ void ProcessInput1(bool Input1On) {
             if( Input1On )
                 SG3525Run(false);
             break;
+
+        //
+        // Run macro I1 when triggered
+        //
+        case INPUT_MACRO:
+            if( Input1On )
+                MacroPost("I1");
+            break;
         }
     }
 
@@ -401,6 +455,14 @@ void ProcessInput2(bool Input2On) {
             if( Input2On )
                 SG3525Run(false);
             break;
+
+        //
+        // Run macro I2 when triggered
+        //
+        case INPUT_MACRO:
+            if( Input2On )
+                MacroPost("I2");
+            break;
         }
     }
 
@@ -67,15 +67,32 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 
 #include <stdint.h>
+#include <string.h>
 
 #include "PortMacros.h"
 #include "Screen.h"
 #include "Command.h"
-#include "Timer.h"
 #include "Serial.h"
+#include "VT100.h"
+#include "Query.h"
+#include "Stream.h"
 
        int      SelectedScreen  NOINIT;
-static TIME_T   NextDisplayTime NOINIT;
+static uint8_t  RefreshTicks    NOINIT;
+
+//
+// A screen being drawn. Each tick sends up to SCREEN_DRAW_BYTES of it: first any
+//   static text left over, then the screen's next drawing steps. Between ticks the
+//   terminal saves the cursor, since replies and echo may go out in the meantime.
+//
+#define DRAW_CHUNK  32                      // Static text copied out at once
+
+static struct {
+    PGM_P       Text;                       // Static text still to send, or NULL
+    uint8_t     Step;                       // Next drawing step
+    bool        Drawing;                    // TRUE while the screen is being drawn
+    bool        Resume;                     // TRUE if cursor was saved last tick
+    } Draw NOINIT;
 
 #define BEEP    "\007"
 
@@ -93,7 +110,8 @@ void ScreenInit(void) {
     //
     // The main screen is shown by default
     //
-    NextDisplayTime = 0;
+    RefreshTicks = 0;
+    memset(&Draw,0,sizeof(Draw));
     ShowScreen('MA');
     }
 
@@ -117,15 +135,14 @@ static void BadScreen(int ScreenType) {
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// ShowScreen - Display the selected screen
+// ShowStep - Draw the next step of the selected screen
 //
-// Inputs:      Two char abbreviation of screen (ie - 'DE')
+// Inputs:      Step of the drawing, starting from 0
 //
-// Outputs:     None.
+// Outputs:     TRUE  if more steps follow
+//              FALSE if the screen is drawn
 //
-void ShowScreen(int ScreenType) {
-
-    SelectedScreen = ScreenType;
+static bool ShowStep(uint8_t Step) {
 
     switch(SelectedScreen) {
 
@@ -134,8 +151,7 @@ void ShowScreen(int ScreenType) {
         //  - Show the main screen
         //
         case 'MA':
-            ShowMAScreen();
-            return;
+            return ShowMAScreen(Step);
 #endif
 
 #ifdef USE_HELP_SCREEN
@@ -143,8 +159,7 @@ void ShowScreen(int ScreenType) {
         // HE - Show the help screen
         //
         case 'HE':
-            ShowHEScreen();
-            return;
+            return ShowHEScreen(Step);
 #endif
 
 #ifdef USE_DEBUG_SCREEN
@@ -152,8 +167,7 @@ void ShowScreen(int ScreenType) {
         // DE - Show the debug screen
         //
         case 'DE':
-            ShowDEScreen();
-            return;
+            return ShowDEScreen(Step);
 #endif
 
 #ifdef USE_MEMORY_SCREEN
@@ -161,8 +175,7 @@ void ShowScreen(int ScreenType) {
         // ME - Show the memory screen
         //
         case 'ME':
-            ShowMEScreen();
-            return;
+            return ShowMEScreen(Step);
 #endif
 
 #ifdef USE_EEPROM_SCREEN
@@ -170,38 +183,141 @@ void ShowScreen(int ScreenType) {
         // EE - Show the memory screen
         //
         case 'EE':
-            ShowEEScreen();
-            return;
+            return ShowEEScreen(Step);
 #endif
         }
 
 #ifdef USE_USER_SCREENS
     if( ShowUserScreen(SelectedScreen) )
-        return;
+        return false;
 #endif
 
     BadScreen(SelectedScreen);
+    return false;
     }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// ScreenUpdate - Update the status screen information
+// ScreenText - Send static text as part of drawing a screen
 //
-// Inputs:      None
+// Inputs:      PROGMEM text to send, no escape sequences
 //
 // Outputs:     None.
 //
-void ScreenUpdate(void) {
-    TIME_T CurrentTime = TimerGetSeconds();
+void ScreenText(PGM_P Text) { Draw.Text = Text; }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ScreenDraw - Send the next part of the screen being drawn
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+// Sends static text, and calls drawing steps, until SCREEN_DRAW_BYTES have been sent
+//   this tick. A step is never split, so a tick may go over by the size of one step.
+//
+static void ScreenDraw(void) {
+    uint16_t    Start = SerialCount();
+    uint8_t     Sent  = 0;
+
+    if( Draw.Resume )
+        CursorRestore;
+
+    while( Sent < SCREEN_DRAW_BYTES ) {
+
+        if( Draw.Text ) {
+            char    Chunk[DRAW_CHUNK];
+            uint8_t Len = SCREEN_DRAW_BYTES - Sent;
+
+            if( Len > sizeof(Chunk) )
+                Len = sizeof(Chunk);
+            Len = strnlen_P(Draw.Text,Len);
+
+            memcpy_P(Chunk,Draw.Text,Len);
+            PrintBlock(Chunk,Len);
+
+            Draw.Text += Len;
+            if( pgm_read_byte(Draw.Text) == 0 )
+                Draw.Text = NULL;
+            }
+        else if( !ShowStep(Draw.Step++) ) {
+            Draw.Drawing = false;
+            PlotCommand();
+            return;
+            }
+
+        uint16_t Count = SerialCount() - Start;
+
+        Sent = Count < SCREEN_DRAW_BYTES ? Count : SCREEN_DRAW_BYTES;
+        }
+
+    CursorSave;
+    Draw.Resume = true;
+    }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ShowScreen - Display the selected screen
+//
+// Inputs:      Two char abbreviation of screen (ie - 'DE')
+//
+// Outputs:     None.
+//
+// Only the first part is drawn now, the rest follows on later ticks.
+//
+void ShowScreen(int ScreenType) {
+
+    SelectedScreen = ScreenType;
 
     //
-    // Wait until at least 1 second has elapsed before we do anything.
+    // Any refresh of the old screen still queued is now pointless
     //
-    if( CurrentTime < NextDisplayTime )
-        return;
+    SerialFlushLo();
 
-    NextDisplayTime = CurrentTime + 1;
+    Draw.Text    = NULL;
+    Draw.Step    = 0;
+    Draw.Drawing = true;
+    Draw.Resume  = false;
+
+    ScreenDraw();
+    }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ScreenMask - Return mask of the selected screen
+//
+// Inputs:      None.
+//
+// Outputs:     SCREEN_xx mask of the selected screen
+//
+uint8_t ScreenMask(void) {
+
+    switch(SelectedScreen) {
+        case 'MA': return SCREEN_MA;
+        case 'HE': return SCREEN_HE;
+        case 'DE': return SCREEN_DE;
+        case 'ME': return SCREEN_ME;
+        case 'EE': return SCREEN_EE;
+        }
+
+    return SCREEN_CUSTOM;
+    }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// UpdateScreen - Send the periodic update for the selected screen
+//
+// Inputs:      None
+//
+// Outputs:     None.
+//
+static void UpdateScreen(void) {
 
     switch(SelectedScreen) {
 
@@ -258,3 +374,55 @@ void ScreenUpdate(void) {
 
     BadScreen(SelectedScreen);
     }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ScreenUpdate - Update the status screen information
+//
+// Inputs:      None
+//
+// Outputs:     None.
+//
+void ScreenUpdate(void) {
+
+    //
+    // Nothing is drawn in machine or stream mode. Leaving them redraws the screen
+    //   from scratch.
+    //
+    if( QueryMode || StreamMode )
+        return;
+
+    //
+    // While a screen is being drawn there is nothing to refresh yet. Draw more, once
+    //   the last part has gone out.
+    //
+    if( Draw.Drawing ) {
+        if( !SerialPending(SERIAL_HI) )
+            ScreenDraw();
+        return;
+        }
+
+    //
+    // Wait until the refresh interval has elapsed before we do anything.
+    //
+    if( RefreshTicks ) {
+        RefreshTicks--;
+        return;
+        }
+
+    //
+    // If the last refresh is still going out, try again next tick. This keeps at most
+    //   one refresh queued, and the screen shows the latest values when it catches up.
+    //
+    if( SerialPending(SERIAL_LO) ) {
+        SerialStats.Deferred++;
+        return;
+        }
+
+    RefreshTicks = (SelectedScreen == 'MA' ? MA_REFRESH_TICKS : SCREEN_REFRESH_TICKS) - 1;
+
+    SerialSetPri(SERIAL_LO);
+    UpdateScreen();
+    SerialSetPri(SERIAL_HI);
+    }
@@ -68,8 +68,11 @@
 #ifndef SCREEN_H
 #define SCREEN_H
 
+#include <stdint.h>
 #include <stdbool.h>
 
+#include <avr/pgmspace.h>
+
 //
 // Uncomment these next to use the pre-built screens
 //
@@ -106,24 +109,20 @@
 #define ERROR_ROW   19
 
 //
-// Static layout of the help screen
+// Ticks between screen refreshes (25 ticks per second). The main screen only sends
+//   fields that changed, so it can refresh more often, with a full redraw every
+//   MA_REDRAW_REFRESHES refreshes in case the terminal missed something.
+//
+#define SCREEN_REFRESH_TICKS    25
+#define MA_REFRESH_TICKS        5
+#define MA_REDRAW_REFRESHES     50
+
+//
+// A new screen is drawn a step at a time, at most this many chars per tick (about the
+//   line rate at 19200 baud), so that showing a screen never holds up the tick. At
+//   slower rates drawing also waits for the previous tick's output to go out.
 //
-#define HELP_SCREEN "\
--- ADNS2610 Test program --\r\n\
-\r\n\
-MA - Show the  main screen\r\n\
-DE - Show the  debug screen\r\n\
-EE - Dump the  EEPROM memory\r\n\
-ME - Dump the  RAM memory\r\n\
-HE - Show this help panel\r\n\
-?  - Show this help panel\r\n\
-\r\n\
-FCW  #  Set freq coarse wiper\r\n\
-FFW  #  Set freq fine   wiper\r\n\
-PW   #  Set power       wiper\r\n\
-ON      Turn transducer on\r\n\
-OF      Turn transducer off\r\n\
-";
+#define SCREEN_DRAW_BYTES       64
 
 //
 // End of user configurable options
@@ -133,6 +132,17 @@ OF      Turn transducer off\r\n\
 
 extern int  SelectedScreen;
 
+//
+// Screen masks, for the screens a command may be used on (see Command.c)
+//
+#define SCREEN_MA       0x01
+#define SCREEN_HE       0x02
+#define SCREEN_DE       0x04
+#define SCREEN_ME       0x08
+#define SCREEN_EE       0x10
+#define SCREEN_CUSTOM   0x80
+#define SCREEN_ALL      0xFF
+
 #ifdef USE_MAIN_SCREEN
 #   include "MAScreen.h"
 #   endif
@@ -179,6 +189,31 @@ void ScreenInit(void);
 //
 void ShowScreen(int ScreenType);
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ScreenMask - Return mask of the selected screen
+//
+// Inputs:      None.
+//
+// Outputs:     SCREEN_xx mask of the selected screen
+//
+uint8_t ScreenMask(void);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ScreenText - Send static text as part of drawing a screen
+//
+// Inputs:      PROGMEM text to send, no escape sequences
+//
+// Outputs:     None.
+//
+// Called from a drawing step. The text goes out over as many ticks as needed, before
+//   the next step is called.
+//
+void ScreenText(PGM_P Text);
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
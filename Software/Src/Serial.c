@@ -19,7 +19,7 @@
 //      PrintD(Value,  0);          // => printf(  "%d",Value);
 //      PrintD(Value,  3);          // => printf( "%3d",Value);
 //      PrintD(Value,103);          // => printf("%03d",Value);
-//      PrintD(Value, -3);          // => printf("%+3d",Value);
+//      PrintD(Value, -3);          // => printf("%-3d",Value);
 //
 //      PrintH(Byte);               // => printf("%02X",Byte);
 //      PrintB(Byte);               // => printf("%02B",Byte);
@@ -94,11 +94,470 @@
 //////////////////////////////////////////////////////////////////////////////////////////
 
 #include <stddef.h>
+#include <string.h>
 #include <avr/pgmspace.h>
 
+#include "PortMacros.h"
 #include "Serial.h"
 #include "UART.h"
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data declarations
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#define ESC         '\033'              // Starts a record (cursor positioning)
+#define PSTR_REF    0                   // Queued PROGMEM string: PSTR_REF, Lo, Hi
+#define BLOCK_MAX   32                  // Longest run of RAM chars queued at once
+
+typedef struct {
+    char   *Buf;                        // Queue storage
+    uint8_t Wrap;                       // Wraparound mask (size-1)
+    uint8_t In;                         // Queue input  pointer
+    uint8_t Out;                        // Queue output pointer
+    uint8_t Record;                     // Start of last record queued
+    PGM_P   PStr;                       // PROGMEM string being sent, or NULL
+    } SERIAL_QUEUE;
+
+static char SerialHiBuf[SERIAL_HI_SIZE] NOINIT;
+static char SerialLoBuf[SERIAL_LO_SIZE] NOINIT;
+
+static struct {
+    SERIAL_QUEUE    Hi;                 // Replies and alarms
+    SERIAL_QUEUE    Lo;                 // Screen refresh
+    SERIAL_QUEUE   *Curr;               // Queue being sent to the UART
+    SERIAL_PRI      Pri;                // Queue receiving output
+    bool            Dropping;           // TRUE if Lo record overflowed, drop to next
+    bool            Cut;                // TRUE if Hi output was dropped, mark the gap
+    bool            Flush;              // TRUE if Lo should be discarded
+    bool            Moved;              // TRUE if output since SerialMarkCursor()
+    bool            Mute;               // TRUE if text output is discarded
+    uint16_t        Count;              // Running count of chars printed
+    } Serial NOINIT;
+
+SERIAL_STATS SerialStats NOINIT;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialInit - Initialize deferred serial output
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void SerialInit(void) {
+
+    memset(&Serial     ,0,sizeof(Serial));
+    memset(&SerialStats,0,sizeof(SerialStats));
+
+    Serial.Hi.Buf  = SerialHiBuf;
+    Serial.Hi.Wrap = SERIAL_HI_SIZE-1;
+    Serial.Lo.Buf  = SerialLoBuf;
+    Serial.Lo.Wrap = SERIAL_LO_SIZE-1;
+    Serial.Curr    = &Serial.Hi;
+    Serial.Pri     = SERIAL_HI;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueueFree - Return free space in queue
+//
+// Inputs:      Queue to check
+//
+// Outputs:     Number of chars that can be added
+//
+static uint8_t QueueFree(SERIAL_QUEUE *Queue) { return (Queue->Out - Queue->In - 1) & Queue->Wrap; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueuePeek - Return next char to be sent from queue
+//
+// Inputs:      Queue to check
+//
+// Outputs:     Next char to send, or
+//              NUL if queue is empty
+//
+// NOTE: A queued PROGMEM string reference is opened here, so that the caller sees
+//         the first char of the string.
+//
+static char QueuePeek(SERIAL_QUEUE *Queue) {
+
+    if( Queue->PStr == NULL ) {
+        if( Queue->In == Queue->Out )
+            return 0;
+
+        if( Queue->Buf[Queue->Out] != PSTR_REF )
+            return Queue->Buf[Queue->Out];
+
+        Queue->PStr = (PGM_P) ((uint8_t) Queue->Buf[(Queue->Out+1) & Queue->Wrap] |
+                              ((uint8_t) Queue->Buf[(Queue->Out+2) & Queue->Wrap] << 8));
+        Queue->Out  = (Queue->Out+3) & Queue->Wrap;
+        }
+
+    return pgm_read_byte(Queue->PStr);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueueRun - Return length of the run of chars that can be sent as one block
+//
+// Inputs:      Queue to check, already opened by QueuePeek()
+//              TRUE if the run must stop at the next record
+//
+// Outputs:     Number of chars, at least 1 and at most OFIFO_SIZE
+//
+// A run stops at the end of a PROGMEM string, at a PROGMEM reference or the queue
+//   wraparound in RAM, and (if asked) at an ESC that starts another record.
+//
+static uint8_t QueueRun(SERIAL_QUEUE *Queue,bool ToRecord) {
+    uint8_t Len;
+    char    Char;
+
+    for( Len = 1; Len < OFIFO_SIZE; Len++ ) {
+
+        if( Queue->PStr )
+            Char = pgm_read_byte(Queue->PStr + Len);
+        else {
+            uint8_t Index = Queue->Out + Len;
+
+            if( (Index & Queue->Wrap) == 0 ||
+                (Index & Queue->Wrap) == Queue->In )
+                break;
+            Char = Queue->Buf[Index & Queue->Wrap];
+            }
+
+        if( Char == 0 || (ToRecord && Char == ESC) )
+            break;
+        }
+
+    return Len;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// QueueAdvance - Remove chars returned by QueueRun() from the queue
+//
+// Inputs:      Queue to advance
+//              Number of chars sent
+//
+// Outputs:     None.
+//
+static void QueueAdvance(SERIAL_QUEUE *Queue,uint8_t Len) {
+
+    if( Queue->PStr ) {
+        Queue->PStr += Len;
+        if( pgm_read_byte(Queue->PStr) == 0 )
+            Queue->PStr = NULL;
+        }
+    else Queue->Out = (Queue->Out+Len) & Queue->Wrap;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialPumpQueues - Move deferred output into the UART
+//
+// Inputs:      TRUE if called while Hi output is being produced
+//
+// Outputs:     None.
+//
+// The Hi queue may interrupt the Lo queue only where a Lo record starts (at an ESC),
+//   so that escape sequences and the chars they position are never split. Lo resumes
+//   once Hi is empty, unless a Hi record is still being produced.
+//
+static void SerialPumpQueues(bool Producing) {
+
+    while(1) {
+        char Char;
+
+        if( Serial.Curr == &Serial.Lo ) {
+            Char = QueuePeek(&Serial.Lo);
+            if( Char == 0 || Char == ESC ) {
+                if( Serial.Flush ) {
+                    Serial.Lo.In   = Serial.Lo.Out;
+                    Serial.Lo.PStr = NULL;
+                    Serial.Flush   = false;
+                    }
+                if( QueuePeek(&Serial.Hi) )
+                    Serial.Curr = &Serial.Hi;
+                }
+            }
+        else if( !Producing && QueuePeek(&Serial.Hi) == 0 )
+            Serial.Curr = &Serial.Lo;
+
+        if( QueuePeek(Serial.Curr) == 0 )
+            return;
+
+        //
+        // Send as much as possible in one block. Lo stops at the next record if Hi
+        //   (or a flush) is waiting for it.
+        //
+        SERIAL_QUEUE *Queue = Serial.Curr;
+        uint8_t       Len   = QueueRun(Queue,Queue == &Serial.Lo &&
+                                             (Serial.Flush || QueuePeek(&Serial.Hi)));
+        uint8_t       Sent;
+
+        if( Queue->PStr ) Sent = PutUARTBlockP(Queue->PStr,Len);
+        else              Sent = PutUARTBlock(Queue->Buf + Queue->Out,Len);
+
+        QueueAdvance(Queue,Sent);
+
+        if( Queue == &Serial.Lo && Sent )
+            Serial.Moved = true;
+
+        if( Sent < Len )
+            return;
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialPump - Move deferred output into the UART
+//
+// Inputs:      None. (Called from the idle loop)
+//
+// Outputs:     None.
+//
+void SerialPump(void) { SerialPumpQueues(false); }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialSetPri - Choose which queue receives output
+//
+// Inputs:      SERIAL_HI for replies and alarms
+//              SERIAL_LO for screen refresh
+//
+// Outputs:     None.
+//
+void SerialSetPri(SERIAL_PRI Pri) {
+
+    Serial.Pri       = Pri;
+    Serial.Dropping  = false;
+    Serial.Lo.Record = Serial.Lo.In;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialPending - Return TRUE if deferred output is still queued
+//
+// Inputs:      Queue to check
+//
+// Outputs:     TRUE  if queue still has chars to send
+//              FALSE if queue is empty
+//
+bool SerialPending(SERIAL_PRI Pri) {
+
+    if( Pri == SERIAL_LO ) return QueuePeek(&Serial.Lo) != 0;
+    else                   return QueuePeek(&Serial.Hi) != 0;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialFlushLo - Discard any screen refresh not yet sent
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+// A record already being sent is finished first.
+//
+void SerialFlushLo(void) { Serial.Flush = true; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialSetMute - Discard, or resume, text output
+//
+// Inputs:      TRUE  to discard text output from now on
+//              FALSE to send it again
+//
+// Outputs:     None.
+//
+// Output already queued still goes out, and binary frames are not affected. This is
+//   for a host that wants only its own replies (see Query.h).
+//
+void SerialSetMute(bool Mute) { Serial.Mute = Mute; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialPutFrame - Send a binary frame between text records
+//
+// Inputs:      Frame to send
+//              Length of frame
+//
+// Outputs:     TRUE  if frame was put into the UART
+//              FALSE if not sent (text waiting, or no room), try again later
+//
+// Replies go first. Screen refresh may be passed, but only where a record starts,
+//   and the frame goes into the UART all at once or not at all.
+//
+bool SerialPutFrame(const char *Frame,uint8_t Len) {
+
+    SerialPumpQueues(false);
+
+    if( QueuePeek(&Serial.Hi) )
+        return false;
+
+    if( Serial.Curr == &Serial.Lo ) {
+        char Char = QueuePeek(&Serial.Lo);
+
+        if( Char != 0 && Char != ESC )
+            return false;
+        }
+
+    if( UARTFree() < Len )
+        return false;
+
+    PutUARTBlock(Frame,Len);
+    Serial.Moved = true;
+    return true;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialMarkCursor - Note that the terminal cursor is where the caller left it
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+// Call after the last output that positioned the cursor.
+//
+void SerialMarkCursor(void) { Serial.Moved = false; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialCursorMoved - Return TRUE if the cursor may have moved since it was marked
+//
+// Inputs:      None.
+//
+// Outputs:     TRUE  if any output could have moved the cursor
+//              FALSE if the cursor is still where SerialMarkCursor() found it
+//
+// Hi output counts when it is queued, since it will reach the terminal after anything
+//   the caller printed before marking. Lo output and frames count only when they go
+//   into the UART, since until then they are behind the caller's output. This way a
+//   refresh record that slips in between two echoed chars is always noticed.
+//
+bool SerialCursorMoved(void) { return Serial.Moved; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialCount - Return running count of chars printed
+//
+// Inputs:      None.
+//
+// Outputs:     Chars printed so far, modulo 65536
+//
+// Counts chars as they will go out on the line, so a PROGMEM string counts its full
+//   length. Take the difference of two counts to measure some output.
+//
+uint16_t SerialCount(void) { return Serial.Count; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialQueue - Add chars to the current output queue
+//
+// Inputs:      Chars to add
+//              Number of chars
+//              First char of output (ESC if a new record)
+//
+// Outputs:     None.
+//
+// Hi output never waits: if there's no room, the queues are pumped into the UART once,
+//   and output that still doesn't fit is dropped (SerialStats.Lost). A '~' goes out
+//   where the gap was, once there's room again. Lo output that doesn't fit is
+//   discarded back to the start of the record, and the rest of the record is dropped.
+//
+static void SerialQueue(const char *Chars,uint8_t Len,char First) {
+    SERIAL_QUEUE *Queue;
+
+    if( Serial.Mute )
+        return;
+
+    Serial.Count += Len;
+
+    if( Serial.Pri == SERIAL_LO ) {
+        Queue = &Serial.Lo;
+
+        if( First == ESC ) {
+            Queue->Record   = Queue->In;
+            Serial.Dropping = false;
+            }
+        else if( Serial.Dropping )
+            return;
+
+        if( QueueFree(Queue) < Len ) {
+            Queue->In       = Queue->Record;
+            Serial.Dropping = true;
+            SerialStats.Dropped++;
+            return;
+            }
+        }
+    else {
+        Queue        = &Serial.Hi;
+        Serial.Moved = true;
+
+        //
+        // Replies never wait for room: the main loop (control tick) mustn't wait
+        //   on the UART or on host flow control. Output that still won't fit after
+        //   one pump is dropped, and a '~' marks the gap once there's room again.
+        //
+        if( QueueFree(Queue) < Len + Serial.Cut )
+            SerialPumpQueues(true);
+
+        if( QueueFree(Queue) < Len + Serial.Cut ) {
+            Serial.Cut = true;
+            SerialStats.Lost++;
+            return;
+            }
+
+        if( Serial.Cut ) {
+            Queue->Buf[Queue->In] = '~';
+            Queue->In  = (Queue->In+1) & Queue->Wrap;
+            Serial.Cut = false;
+            }
+        }
+
+    while( Len-- ) {
+        Queue->Buf[Queue->In] = *Chars++;
+        Queue->In = (Queue->In+1) & Queue->Wrap;
+        }
+    }
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -108,7 +567,13 @@
 //
 // Outputs:     None.
 //
-void PrintChar(char Char) { PutUARTByteW(Char); }
+// A NUL char is ignored, since it marks a PROGMEM reference in the queue.
+//
+void PrintChar(char Char) {
+
+    if( Char )
+        SerialQueue(&Char,1,Char);
+    }
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -122,8 +587,34 @@ void PrintChar(char Char) { PutUARTByteW(Char); }
 //
 void PrintString(const char *String) {
 
-    while( *String )
-        PrintChar(*String++);
+    while( *String ) {
+        uint8_t Len = strnlen(String,BLOCK_MAX);
+
+        SerialQueue(String,Len,*String);
+        String += Len;
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PrintBlock - Print out a block of chars
+//
+// Inputs:      Chars to print (no NULs)
+//              Number of chars
+//
+// Outputs:     None.
+//
+void PrintBlock(const char *Block,uint8_t Len) {
+
+    while( Len ) {
+        uint8_t Run = Len < BLOCK_MAX ? Len : BLOCK_MAX;
+
+        SerialQueue(Block,Run,*Block);
+        Block += Run;
+        Len   -= Run;
+        }
     }
 
 
@@ -136,11 +627,22 @@ void PrintString(const char *String) {
 //
 // Outputs:     None.
 //
+// The string stays in program memory: only a reference to it is queued, and it is
+//   read out as it is sent.
+//
 void PrintStringP(const char *String) {
-    char    Char;
+    char    Ref[3];
+    char    First = pgm_read_byte(String);
+
+    if( First == 0 || Serial.Mute )
+        return;
+
+    Ref[0] = PSTR_REF;
+    Ref[1] = ((uint16_t) String) & 0xFF;
+    Ref[2] = ((uint16_t) String) >> 8;
 
-    while( (Char = pgm_read_byte(String++)) )
-        PrintChar(Char);
+    SerialQueue(Ref,sizeof(Ref),First);
+    Serial.Count += strlen_P(String) - sizeof(Ref);
     }
 
 
@@ -153,30 +655,53 @@ void PrintStringP(const char *String) {
 //
 // Outputs:     None.
 //
-void PrintCRLF(void) { PrintChar('\r'); PrintChar('\n'); }
+void PrintCRLF(void) { PrintStringP(PSTR("\r\n")); }
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// PrintD - Printf integer with %d format
+// FormatD - Convert integer to decimal digits
 //
-// Inputs:      Integer to convert
-//              Width of field:
+// Inputs:      Where the digits should end (one past the last digit)
+//              Integer to convert
 //
-//                  0       The output is unpadded, as in %d
-//                  n       The output is right justified in n spaces
-//                  -n      The output is left  justified in n spaces
-//                  100+n   Like n, with lead zeroes
+// Outputs:     First digit of the conversion. Nothing is NUL terminated.
 //
-// Outputs:     None.
+// Each digit takes one multiply by the reciprocal of 10: (x * 0xCCCD) >> 19 is x/10
+//   for every 16 bit x. The product needs 32 bits, so gcc calls the library 32x32
+//   multiply (__mulsi3, a few dozen cycles with the hardware MUL), which is still
+//   far cheaper than the library divide (__udivmodhi4, a bit at a time), and the
+//   time per digit doesn't depend on the digit.
 //
-static int Divisors[] PROGMEM = { 10000, 1000, 100, 10 };
+char *FormatD(char *End,uint16_t Value) {
 
-void PrintD(uint16_t Value,int8_t Width) {
-    uint8_t CharsPrinted = 0;
-    uint8_t Index;
+    do {
+        uint16_t Quot = ((uint32_t) Value * 0xCCCDu) >> 19;
+
+        *--End = '0' + (uint8_t) (Value - Quot*10);
+        Value  = Quot;
+        } while( Value );
+
+    return End;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PadField - Put converted digits into a line, padded to a field width
+//
+// Inputs:      Where to put the field (room for PRINTD_MAX chars)
+//              Digits to put
+//              Number of digits
+//              Width of field, as with PrintD()
+//
+// Outputs:     Next char in line
+//
+char *PadField(char *Out,const char *Digits,uint8_t Len,int8_t Width) {
     char    PadChar = ' ';
+    uint8_t Pad     = 0;
 
     //
     // If the Width field is > 100, then it's a signal to pad the
@@ -187,47 +712,70 @@ void PrintD(uint16_t Value,int8_t Width) {
         PadChar = '0';
         }
 
-    for( Index = 0; Index < 4; Index++ ) {
-        uint16_t    Divisor = pgm_read_word(&Divisors[Index]);
-        char        OutChar = '0';
-
-        while( Value >= Divisor ) {
-            Value -= Divisor;
-            OutChar++;
-            }
-
-        if( OutChar != '0' || CharsPrinted ) {
-            if( CharsPrinted == 0 && Width > 0 ) {
-                uint8_t Chars = 5-Index;
-                if( Width < Chars )
-                    Width = Chars;
-                while( Width > Chars ) {
-                    PrintChar(PadChar);
-                    Width--;
-                    }
-                }
+    if( Width >  PRINTD_MAX ) Width =  PRINTD_MAX;
+    if( Width < -PRINTD_MAX ) Width = -PRINTD_MAX;
 
-            PrintChar(OutChar);
-            CharsPrinted++;
-            }
+    if( Width > 0 && Len < Width ) {
+        Pad = Width - Len;
+        memset(Out,PadChar,Pad);
+        Out += Pad;
+        Pad  = 0;
         }
+    else if( Width < 0 && Len < -Width )
+        Pad = -Width - Len;
 
-    //
-    // Print out the last character.
-    //
-    if( CharsPrinted == 0 && Width > 0 )
-        while( --Width ) {
-            PrintChar(PadChar);
-            }
-
-    PrintChar('0' + Value);
+    memcpy(Out,Digits,Len);
+    Out += Len;
 
     //
     // If we were left justified, pad out the rest of the field.
     //
-    if( Width < 0 )
-        while( ++CharsPrinted < -Width )
-            PrintChar(PadChar);
+    memset(Out,PadChar,Pad);
+    return Out + Pad;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PrintField - Print converted digits, padded to a field width
+//
+// Inputs:      Digits to print
+//              Number of digits
+//              Width of field, as with PrintD()
+//
+// Outputs:     None.
+//
+// The field is built in a local buffer and queued as one block.
+//
+void PrintField(const char *Digits,uint8_t Len,int8_t Width) {
+    char    Buf[PRINTD_MAX];
+
+    PrintBlock(Buf,PadField(Buf,Digits,Len,Width) - Buf);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PrintD - Printf integer with %d format
+//
+// Inputs:      Integer to convert
+//              Width of field:
+//
+//                  0       The output is unpadded, as in %d
+//                  n       The output is right justified in n spaces
+//                  -n      The output is left  justified in n spaces
+//                  100+n   Like n, with lead zeroes
+//
+// Outputs:     None.
+//
+void PrintD(uint16_t Value,int8_t Width) {
+    char    Buf[5];
+    char   *End    = Buf + sizeof(Buf);
+    char   *Digits = FormatD(End,Value);
+
+    PrintField(Digits,End-Digits,Width);
     }
 
 
@@ -247,9 +795,11 @@ static char HexChars[] PROGMEM = {
     'C', 'D', 'E', 'F' };
 
 void PrintH(uint8_t Byte) {
+    char Buf[2];
 
-    PrintChar(pgm_read_byte(HexChars + (Byte >>    4)));
-    PrintChar(pgm_read_byte(HexChars + (Byte &  0x0F)));
+    Buf[0] = pgm_read_byte(HexChars + (Byte >>    4));
+    Buf[1] = pgm_read_byte(HexChars + (Byte &  0x0F));
+    PrintBlock(Buf,sizeof(Buf));
     }
 
 
@@ -263,10 +813,13 @@ void PrintH(uint8_t Byte) {
 // Outputs:     None.
 //
 void PrintB(uint8_t Byte) {
-    int Bit;
+    char Buf[8];
+    int  Bit;
 
     for( Bit = 0; Bit < 8; Bit++ ) {
-        PrintChar((Byte & 0x80) == 0 ? '0' : '1');
+        Buf[Bit] = (Byte & 0x80) == 0 ? '0' : '1';
         Byte <<= 1;
         }
+
+    PrintBlock(Buf,sizeof(Buf));
     }
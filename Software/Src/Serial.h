@@ -19,7 +19,7 @@
 //      PrintD(Value,  0);          // => printf(  "%d",Value);
 //      PrintD(Value,  3);          // => printf( "%3d",Value);
 //      PrintD(Value,103);          // => printf("%03d",Value);
-//      PrintD(Value, -3);          // => printf("%+3d",Value);
+//      PrintD(Value, -3);          // => printf("%-3d",Value);
 //
 //      PrintLD(Value,#)            // => printf of (long) value
 //
@@ -35,6 +35,23 @@
 //
 //      PrintStringP(String1);      // => printf("%s",String);
 //
+//      //////////////////////////////////////
+//      //
+//      // In Main.c
+//      //
+//      SerialInit();               // Called once at startup, after UARTInit()
+//
+//      while(1) {
+//          while( !TimerUpdate() ) {
+//              sleep_cpu();
+//              SerialPump();       // Move deferred output into the UART
+//              }
+//          }
+//
+//      SerialSetPri(SERIAL_LO);    // Screen refresh output
+//          :
+//      SerialSetPri(SERIAL_HI);    // Replies and alarms (default)
+//
 //  DESCRIPTION
 //
 //      Simple UART serial interface.
@@ -67,7 +84,43 @@
 //      Decimal constants do not have this problem.
 //
 //      The PrintD function does not use divide or modulo, which might
-//        otherwise require a large [and slow] library call.
+//        otherwise require a large [and slow] library call. FormatD() converts
+//        with a multiply by the reciprocal of 10 instead, and PrintField() pads
+//        the digits, so other number formats can be built from the same parts.
+//
+//  DEFERRED OUTPUT:
+//
+//      Printing never waits for the UART. Output goes to one of two queues, which
+//        SerialPump() moves into the UART Tx FIFO as it empties:
+//
+//      SERIAL_HI:  Command replies, echo, and alarms. Sized to hold any normal
+//                    reply. If a reply won't fit, the queue is pumped once; what
+//                    still won't fit is dropped (SerialStats.Lost), and a '~' is
+//                    sent where the gap was. Nothing waits for room, so the
+//                    control tick never depends on the UART or host flow control.
+//
+//      SERIAL_LO:  Periodic screen refresh. A refresh is made of records, each
+//                    starting with an ESC (cursor positioning). Hi output may go
+//                    ahead of Lo output, but only between records. A record that
+//                    won't fit is dropped whole (SerialStats.Dropped); the field
+//                    is redrawn on the next refresh.
+//
+//      The screen code coalesces refreshes: a refresh is put off while the previous
+//        one is still queued (SerialStats.Deferred), and pending refresh is flushed
+//        when a new screen is drawn.
+//
+//      Binary frames (such as telemetry) bypass the queues. SerialPutFrame() puts a
+//        frame into the UART whole, only when no Hi output is waiting and the Lo
+//        output is between records, so frames and text never interleave.
+//
+//      PrintStringP() queues only a reference to the PROGMEM string, so static
+//        screen text takes 3 bytes of queue no matter how long it is.
+//
+//      Since Lo records may land between any two Hi outputs, the caller can't know
+//        where the terminal cursor is from its own output alone. SerialMarkCursor()
+//        notes that the cursor is where the caller left it, and SerialCursorMoved()
+//        tells whether any output (queued Hi, or Lo and frames actually sent) has
+//        gone out since. The echo uses this to skip repositioning the cursor.
 //
 //  VERSION:    2010.12.05
 //
@@ -99,9 +152,163 @@
 #define SERIAL_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include <avr/pgmspace.h>
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// The output queues must be a power of two long each (max 256)
+//
+#define SERIAL_HI_SIZE  (1 << 7)        // == 128 chars replies and alarms
+#define SERIAL_LO_SIZE  (1 << 8)        // == 256 chars screen refresh
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+typedef enum {
+    SERIAL_HI = 0,          // Replies and alarms
+    SERIAL_LO,              // Screen refresh
+    } SERIAL_PRI;
+
+typedef struct {
+    uint16_t    Deferred;   // Screen refreshes put off, previous one still queued
+    uint16_t    Dropped;    // Screen refresh records dropped for lack of room
+    uint16_t    Lost;       // Reply output dropped for lack of room
+    } SERIAL_STATS;
+
+extern SERIAL_STATS SerialStats;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialInit - Initialize deferred serial output
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void SerialInit(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialPump - Move deferred output into the UART
+//
+// Inputs:      None. (Called from the idle loop)
+//
+// Outputs:     None.
+//
+void SerialPump(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialSetPri - Choose which queue receives output
+//
+// Inputs:      SERIAL_HI for replies and alarms
+//              SERIAL_LO for screen refresh
+//
+// Outputs:     None.
+//
+void SerialSetPri(SERIAL_PRI Pri);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialPending - Return TRUE if deferred output is still queued
+//
+// Inputs:      Queue to check
+//
+// Outputs:     TRUE  if queue still has chars to send
+//              FALSE if queue is empty
+//
+bool SerialPending(SERIAL_PRI Pri);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialFlushLo - Discard any screen refresh not yet sent
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void SerialFlushLo(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialSetMute - Discard, or resume, text output
+//
+// Inputs:      TRUE  to discard text output from now on
+//              FALSE to send it again
+//
+// Outputs:     None.
+//
+void SerialSetMute(bool Mute);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialPutFrame - Send a binary frame between text records
+//
+// Inputs:      Frame to send
+//              Length of frame
+//
+// Outputs:     TRUE  if frame was put into the UART
+//              FALSE if not sent (text waiting, or no room), try again later
+//
+bool SerialPutFrame(const char *Frame,uint8_t Len);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialMarkCursor - Note that the terminal cursor is where the caller left it
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void SerialMarkCursor(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialCursorMoved - Return TRUE if the cursor may have moved since it was marked
+//
+// Inputs:      None.
+//
+// Outputs:     TRUE  if any output could have moved the cursor
+//              FALSE if the cursor is still where SerialMarkCursor() found it
+//
+bool SerialCursorMoved(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SerialCount - Return running count of chars printed
+//
+// Inputs:      None.
+//
+// Outputs:     Chars printed so far, modulo 65536
+//
+uint16_t SerialCount(void);
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -114,6 +321,22 @@
 void PrintString(const char *String);
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PrintBlock - Print out a block of chars
+//
+// Queues the whole block at once, rather than char by char. Handy for building a
+//   line of output in a local buffer.
+//
+// Inputs:      Chars to print (no NULs)
+//              Number of chars
+//
+// Outputs:     None.
+//
+void PrintBlock(const char *Block,uint8_t Len);
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -145,6 +368,52 @@ void PrintStringP(PGM_P String);
 void PrintD (uint16_t Value,int8_t Width);
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FormatD - Convert integer to decimal digits
+//
+// Inputs:      Where the digits should end (one past the last digit)
+//              Integer to convert
+//
+// Outputs:     First digit of the conversion. Nothing is NUL terminated.
+//
+char *FormatD(char *End,uint16_t Value);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PadField - Put converted digits into a line, padded to a field width
+//
+// Inputs:      Where to put the field (room for PRINTD_MAX chars)
+//              Digits to put
+//              Number of digits
+//              Width of field, as with PrintD()
+//
+// Outputs:     Next char in line
+//
+// Widths are limited to PRINTD_MAX.
+//
+#define PRINTD_MAX  15
+
+char *PadField(char *Out,const char *Digits,uint8_t Len,int8_t Width);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PrintField - Print converted digits, padded to a field width
+//
+// Inputs:      Digits to print
+//              Number of digits
+//              Width of field, as with PrintD()
+//
+// Outputs:     None.
+//
+void PrintField(const char *Digits,uint8_t Len,int8_t Width);
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -63,6 +63,41 @@
 #include "Serial.h"
 #include "UART.h"
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FormatLD - Convert long integer to decimal digits
+//
+// Inputs:      Where the digits should end (one past the last digit)
+//              Integer to convert
+//
+// Outputs:     First digit of the conversion. Nothing is NUL terminated.
+//
+// While the value needs more than 16 bits, it is divided by 10 a byte at a time from
+//   the top (long division in base 256), each byte step being a 16 bit reciprocal
+//   multiply. The rest is left to FormatD().
+//
+char *FormatLD(char *End,uint32_t Value) {
+
+    while( Value > 0xFFFF ) {
+        uint8_t *Byte = ((uint8_t *) &Value) + sizeof(Value);      // Little endian
+        uint8_t  Rem  = 0;
+
+        do {
+            uint16_t Part = ((uint16_t) Rem << 8) | *--Byte;
+            uint8_t  Quot = ((uint32_t) Part * 0xCCCDu) >> 19;
+
+            Rem   = Part - Quot*10;
+            *Byte = Quot;
+            } while( Byte != (uint8_t *) &Value );
+
+        *--End = '0' + Rem;
+        }
+
+    return FormatD(End,Value);
+    }
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -78,64 +113,12 @@
 //
 // Outputs:     None.
 //
-static long Divisors[] PROGMEM = { 1000000000, 100000000, 10000000, 1000000,
-                                  100000, 10000, 1000, 100, 10 };
-
 void PrintLD(uint32_t Value,int8_t Width) {
-    uint8_t CharsPrinted = 0;
-    uint8_t Index;
-    char    PadChar = ' ';
-
-    //
-    // If the Width field is > 100, then it's a signal to pad the
-    //   field with zeroes instead of spaces.
-    //
-    if( Width > 100 ) {
-        Width -= 100;
-        PadChar = '0';
-        }
-
-    for( Index = 0; Index < 9; Index++ ) {
-        uint32_t    Divisor = pgm_read_dword(&Divisors[Index]);
-        char        OutChar = '0';
-
-        while( Value >= Divisor ) {
-            Value -= Divisor;
-            OutChar++;
-            }
-
-        if( OutChar != '0' || CharsPrinted ) {
-            if( CharsPrinted == 0 && Width > 0 ) {
-                uint8_t Chars = 5-Index;
-                if( Width < Chars )
-                    Width = Chars;
-                while( Width > Chars ) {
-                    PrintChar(PadChar);
-                    Width--;
-                    }
-                }
-
-            PrintChar(OutChar);
-            CharsPrinted++;
-            }
-        }
+    char    Buf[10];
+    char   *End    = Buf + sizeof(Buf);
+    char   *Digits = FormatLD(End,Value);
 
-    //
-    // Print out the last character.
-    //
-    if( CharsPrinted == 0 && Width > 0 )
-        while( --Width ) {
-            PrintChar(PadChar);
-            }
-
-    PrintChar('0' + Value);
-
-    //
-    // If we were left justified, pad out the rest of the field.
-    //
-    if( Width < 0 )
-        while( ++CharsPrinted < -Width )
-            PrintChar(PadChar);
+    PrintField(Digits,End-Digits,Width);
     }
 
 
@@ -180,7 +163,7 @@ void PrintLB(uint32_t DWord) {
     int Bit;
 
     for( Bit = 0; Bit < 32; Bit++ ) {
-        PrintChar((DWord & 0x800000) == 0 ? '0' : '1');
+        PrintChar((DWord & 0x80000000) == 0 ? '0' : '1');
         DWord <<= 1;
         }
     }
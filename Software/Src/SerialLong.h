@@ -14,7 +14,7 @@
 //      PrintLD(Value,  0);          // => printf(  "%d",Value);
 //      PrintLD(Value,  3);          // => printf( "%3d",Value);
 //      PrintLD(Value,103);          // => printf("%03d",Value);
-//      PrintLD(Value, -3);          // => printf("%+3d",Value);
+//      PrintLD(Value, -3);          // => printf("%-3d",Value);
 //
 //      PrintLH(Value);              // => printf("%08X",Long);
 //      PrintLB(Value);              // => printf("%032B",Long);
@@ -79,6 +79,19 @@
 void PrintLD(uint32_t Value,int8_t Width);
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// FormatLD - Convert long integer to decimal digits
+//
+// Inputs:      Where the digits should end (one past the last digit)
+//              Integer to convert
+//
+// Outputs:     First digit of the conversion. Nothing is NUL terminated.
+//
+char *FormatLD(char *End,uint32_t Value);
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -52,6 +52,7 @@
 #include "EEPROM.h"
 
 #include "Serial.h"
+#include "Format.h"
 #include "Command.h"
 #include "Parse.h"
 #include "MAScreen.h"
@@ -84,9 +85,10 @@ static char IAT1[] PROGMEM = "Unused";
 static char IAT2[] PROGMEM = "Switch transducer";
 static char IAT3[] PROGMEM = "Push on/Push off transducer";
 static char IAT4[] PROGMEM = "EStop";
+static char IAT5[] PROGMEM = "Run macro";
 
 static char *InputActionText[NUM_ACTIONS] = {
-    IAT1, IAT2, IAT3, IAT4
+    IAT1, IAT2, IAT3, IAT4, IAT5
     };
 
 static char PMT1[] PROGMEM = "Constant freq/power";
@@ -117,6 +119,11 @@ void SetupInit(void) {
     if( EEPROM.Version != EEPROM_CURR_VERSION ) {
         for( CurrSetup = 0; CurrSetup < MAX_SETUPS; CurrSetup++ )
             memcpy_P(&EEPROM.Setups[CurrSetup],&SetupDefaults,sizeof(SetupDefaults));
+        memcpy_P(EEPROM.FaultActions,FaultDefaults,sizeof(EEPROM.FaultActions));
+        EEPROM.ACS712Cal.Zero = ACS712_DEF_ZERO;
+        EEPROM.ACS712Cal.Gain = ACS712_DEF_GAIN;
+        EEPROM.ThermalCal.Offset = THERMAL_DEF_OFFSET;
+        memset(EEPROM.Macros,0,sizeof(EEPROM.Macros));
         EEPROM.Version = EEPROM_CURR_VERSION;
         EEPROMWrite();
         }
@@ -136,8 +143,8 @@ void SetupInit(void) {
 //
 void LoadSetup(uint8_t Setup) {
 
-    CurrSetup = Setup;
-    SG3525Set = EEPROM.Setups[Setup].Setup;
+    CurrSetup     = Setup;
+    *SG3525Edit() = EEPROM.Setups[Setup].Setup;
     }
 
 
@@ -170,29 +177,15 @@ void SaveSetup(uint8_t Setup) {
 static void PrintSetup(uint8_t SetupID,SG3525_SET *Setup) {
 
     StartMsg();
-    PrintStringP(PSTR("Setup "));
-    if( SetupID == -1 ) PrintStringP(PSTR(" (working)"));
-    else {
-        PrintD(SetupID,0);                  // == %d
-        if( SetupID == CurrSetup )
-            PrintStringP(PSTR(" (current)"));
-        }
-    PrintStringP(PSTR(":\r\n"));
-
-    PrintStringP(PSTR("Xducer: "));
-//    PrintD(Setup->Transducer.ResFreq,5);
-    PrintStringP(PSTR("Hz, "));
-//    PrintD(Setup->Transducer.MaxPower,3);
-    PrintStringP(PSTR(" max Watts\r\n"));
-
-    PrintStringP(PSTR("Output: "));
-    if( Setup->RunMode == RUN_CONTINUOUS )
-        PrintStringP(PSTR("Continuous\r\n"));
-    else {
-        PrintStringP(PSTR("Timed "));
-        PrintD(Setup->RunTimer,5);
-        PrintCRLF();
-        }
+    if( SetupID == (uint8_t) -1 ) PrintF("Setup (working):\r\n");
+    else                          PrintF("Setup %u%s:\r\n",SetupID,
+                                         SetupID == CurrSetup ? PSTR(" (current)") : PSTR(""));
+
+//    PrintF("Xducer: %5uHz, %3u max Watts\r\n",Setup->Transducer.ResFreq,Setup->Transducer.MaxPower);
+    PrintF("Xducer: Hz,  max Watts\r\n");
+
+    if( Setup->RunMode == RUN_CONTINUOUS ) PrintF("Output: Continuous\r\n");
+    else                                   PrintF("Output: Timed %5u\r\n",Setup->RunTimer);
     }
 
 
@@ -209,12 +202,8 @@ static void PrintSetup(uint8_t SetupID,SG3525_SET *Setup) {
 static void PrintInputMode(uint8_t InputID,INPUT *Input) {
 
     StartMsg();
-    PrintStringP(PSTR("Mode I"));
-    PrintChar('0' + InputID);
-    PrintStringP(PSTR(": "));
-    PrintStringP(InputActionText[IDX_ACTION(Input->Action)]);
-    if( Input->Print )
-        PrintStringP(PSTR(" +print"));
+    PrintF("Mode I%u: %s%s",InputID,InputActionText[IDX_ACTION(Input->Action)],
+           Input->Print ? PSTR(" +print") : PSTR(""));
     }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -223,11 +212,12 @@ static void PrintInputMode(uint8_t InputID,INPUT *Input) {
 // ModeInputCmd - Interpret "MO Ix" command arguments
 //
 // Inputs:      Input of note (1 or 2)
-//              Token after "MO Ix"
+//              Tokens after "MO Ix"
 //
 // Outputs:     None.
 //
-static void ModeInputCmd(uint8_t InputID,char *Command) {
+static void ModeInputCmd(uint8_t InputID,char *Argv[]) {
+    char           *Command = Argv[0];
     INPUT          *Input;
     INPUT_ACTION    Action;
     bool            Print;
@@ -235,8 +225,8 @@ static void ModeInputCmd(uint8_t InputID,char *Command) {
     //
     // Note - Caller will error if anything other than I1 or I2 is used.
     //
-    if ( InputID == 1 ) Input = &SG3525Set.Input1;
-    else                Input = &SG3525Set.Input2;
+    if ( InputID == 1 ) Input = &SG3525Edit()->Input1;
+    else                Input = &SG3525Edit()->Input2;
 
     //
     // Accept blank "MO Ix" command as a request to print current mode
@@ -280,11 +270,19 @@ static void ModeInputCmd(uint8_t InputID,char *Command) {
         ArgOK  = true;
         }
 
+    //
+    // MC - Input runs macro I1 or I2
+    //
+    if( StrEQ(Command,"MC") ) {
+        Action = INPUT_MACRO;
+        ArgOK  = true;
+        }
+
     StartMsg();
     if( !ArgOK ) {
         PrintStringP(PSTR("Unrecognized input mode ("));
         PrintString(Command);
-        PrintStringP(PSTR("), must be U, XC, PO, or ES.\r\n"));
+        PrintStringP(PSTR("), must be U, XC, PO, ES, or MC.\r\n"));
         PrintStringP(PSTR("Type '?' for help\r\n"));
         return;
         }
@@ -292,7 +290,7 @@ static void ModeInputCmd(uint8_t InputID,char *Command) {
     //
     // See if "P" appended to mode
     //
-    Command = ParseToken();
+    Command = Argv[1];
     Print   = false;
 
     if( strlen(Command) > 0 ) {
@@ -317,11 +315,13 @@ static void ModeInputCmd(uint8_t InputID,char *Command) {
 //
 // ModeCmd - Interpret "MO" command arguments
 //
-// Inputs:      Token after "MO"
+// Inputs:      Tokens after "MO"
 //
 // Outputs:     None.
 //
-static void ModeCmd(char *Command) {
+static void ModeCmd(char *Argv[]) {
+    char       *Command = Argv[0];
+    SG3525_SET *Set     = SG3525Edit();
 
     //
     // Accept blank "MO" command as a request to print current mode
@@ -329,7 +329,7 @@ static void ModeCmd(char *Command) {
     if( !strlen(Command) ) {
         StartMsg();
         PrintStringP(PSTR("Current mode: "));
-        PrintStringP(PwrModeText[IDX_PWR_MODE(SG3525Set.PwrMode)]);
+        PrintStringP(PwrModeText[IDX_PWR_MODE(Set->PwrMode)]);
         return;
         }
 
@@ -339,7 +339,7 @@ static void ModeCmd(char *Command) {
     if( StrEQ(Command,"R") ) {
         StartMsg();
         PrintStringP(PSTR("Run continuous"));
-        SG3525Set.RunMode = RUN_CONTINUOUS;
+        Set->RunMode = RUN_CONTINUOUS;
         return;
         }
 
@@ -347,25 +347,15 @@ static void ModeCmd(char *Command) {
     // RT - Set timed run mode
     //
     if( StrEQ(Command,"RT") ) {
-        char *TimeText  = ParseToken();
-        int   TimeTicks = atoi(TimeText);
-
-        if( !strlen(TimeText) ||
-            TimeTicks < 0      ) {
-            StartMsg();
-            PrintStringP(PSTR("Bad or out of range run time ("));
-            PrintString(TimeText);
-            PrintStringP(PSTR("), must be positive number.\r\n"));
-            PrintStringP(PSTR("Type '?' for help\r\n"));
+        uint16_t TimeTicks;
+
+        if( !CommandArg(Argv[1],UNIT_TICKS,0,0xFFFF,&TimeTicks) )
             return;
-            }
 
         StartMsg();
-        PrintStringP(PSTR("Run for "));
-        PrintD(TimeTicks,0);
-        PrintStringP(PSTR(" ticks."));
-        SG3525Set.RunMode  = RUN_TIMED;
-        SG3525Set.RunTimer = TimeTicks;
+        PrintF("Run for %u ticks.",TimeTicks);
+        Set->RunMode  = RUN_TIMED;
+        Set->RunTimer = TimeTicks;
         return;
         }
 
@@ -376,7 +366,7 @@ static void ModeCmd(char *Command) {
     if( StrEQ(Command,"CF") ) {
         StartMsg();
         PrintStringP(PSTR("Constant frequency mode"));
-        SG3525Set.PwrMode = PWR_CONST_FREQ;
+        Set->PwrMode = PWR_CONST_FREQ;
         return;
         }
 
@@ -389,7 +379,7 @@ static void ModeCmd(char *Command) {
         PrintStringP(PSTR("Calibration mode\r\n\r\n"));
         PrintStringP(PSTR("Disconnect transducer from system,"));
         PrintStringP(PSTR("  then enter \"on\" to begin calibration\r\n"));
-        SG3525Set.PwrMode = PWR_CAL;
+        Set->PwrMode = PWR_CAL;
         return;
         }
 
@@ -398,7 +388,7 @@ static void ModeCmd(char *Command) {
     //
     if( StrEQ(Command,"I1") ||
         StrEQ(Command,"I2") ) {
-        ModeInputCmd(Command[1] - '0',ParseToken());
+        ModeInputCmd(Command[1] - '0',&Argv[1]);
         return;
         }
 
@@ -410,7 +400,7 @@ static void ModeCmd(char *Command) {
     if( StrEQ(Command,"CW") ) {
         StartMsg();
         PrintStringP(PSTR("Constant wiper mode"));
-        SG3525Set.PwrMode = PWR_CONST_WIPER;
+        Set->PwrMode = PWR_CONST_WIPER;
         return;
         }
 #endif // USE_WIPER_CMDS
@@ -425,71 +415,82 @@ static void ModeCmd(char *Command) {
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// SetupCmd - Interpret typed commands for setup processing
+// SetupModeCmd - MO - Mode command
 //
-// Inputs:      Command to interpret
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
 //
-// Outputs:     TRUE  if we understood and processed command
-//              FALSE if command isn't ours, belongs to another system
+// Outputs:     None.
 //
-bool SetupCmd(char *Command) {
+void SetupModeCmd(uint8_t Argc,char *Argv[]) {
 
-    //
-    // MO - Mode command
-    //
-    if( StrEQ(Command,"MO") ) {
-        ModeCmd(ParseToken());
-        return true;
-        }
+    ModeCmd(&Argv[1]);
+    }
 
 
-    //
-    // LS - Save setup
-    //
-    if( StrEQ(Command,"LS") ) {
-        char *SetupText = ParseToken();
-        int   SetupNum  = atoi(SetupText);
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SetupLoadCmd - LS - Load setup
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// A setup number has already been range checked by the command table.
+//
+void SetupLoadCmd(uint8_t Argc,char *Argv[]) {
+    uint16_t SetupNum = CurrSetup;
 
-        if( !strlen(SetupText) )
-            SetupNum = CurrSetup;
+    ParseNum(Argv[1],&SetupNum);
 
-        LoadSetup(SetupNum);
+    LoadSetup(SetupNum);
 
-        StartMsg();
-        PrintStringP(PSTR("Loaded setup "));
-        PrintD(CurrSetup,0);            // == %d
-        return true;
-        }
+    StartMsg();
+    PrintF("Loaded setup %u",CurrSetup);
+    }
 
-    //
-    // PS - Print current setup
-    //
-    if( StrEQ(Command,"PS") ) {
-        char *SetupText = ParseToken();
-        int   SetupNum  = atoi(SetupText);
 
-        if( !strlen(SetupText) ) PrintSetup(-1      ,&SG3525Set);
-        else                     PrintSetup(SetupNum,&EEPROM.Setups[SetupNum].Setup);
-        return true;
-        }
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SetupPrintCmd - PS - Print current setup
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// A setup number has already been range checked by the command table.
+//
+void SetupPrintCmd(uint8_t Argc,char *Argv[]) {
+    uint16_t SetupNum;
 
-    //
-    // SS - Save current setup
-    //
-    if( StrEQ(Command,"SS") ) {
-        char *SetupText = ParseToken();
-        int   SetupNum  = atoi(SetupText);
+    if( !ParseNum(Argv[1],&SetupNum) ) PrintSetup(-1      ,&SG3525Set);
+    else                               PrintSetup(SetupNum,&EEPROM.Setups[SetupNum].Setup);
+    }
 
-        if( !strlen(SetupText) )
-            SetupNum = CurrSetup;
 
-        SaveSetup(SetupNum);
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SetupSaveCmd - SS - Save current setup
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// A setup number has already been range checked by the command table.
+//
+void SetupSaveCmd(uint8_t Argc,char *Argv[]) {
+    uint16_t SetupNum = CurrSetup;
+
+    ParseNum(Argv[1],&SetupNum);
 
-        StartMsg();
-        PrintStringP(PSTR("Saved as setup "));
-        PrintD(CurrSetup,SetupNum);            // == %d
-        return true;
-        }
+    SaveSetup(SetupNum);
 
-    return false;
+    StartMsg();
+    PrintF("Saved as setup %u",SetupNum);
     }
@@ -126,14 +126,19 @@ void SaveSetup(uint8_t Setup);
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
-// SetupCmd - Parse setup management commands
+// SetupxxCmd - Typed setup management commands
 //
-// Inputs:      Command to process
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
 //
-// Outputs:     TRUE  if we understood and processed command
-//              FALSE if command isn't ours, belongs to another subsystem
+// Outputs:     None.
 //
-bool SetupCmd(char *Command);
+// Called from the command table in Command.c
+//
+void SetupModeCmd(uint8_t Argc,char *Argv[]);           // MO
+void SetupLoadCmd(uint8_t Argc,char *Argv[]);           // LS
+void SetupPrintCmd(uint8_t Argc,char *Argv[]);          // PS
+void SetupSaveCmd(uint8_t Argc,char *Argv[]);           // SS
 
 
 #endif  // SETUP_H - entire file
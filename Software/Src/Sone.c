@@ -52,6 +52,10 @@
 #include "Debug.h"
 #include "EEPROM.h"
 #include "Inputs.h"
+#include "Telemetry.h"
+#include "Stream.h"
+#include "ACS712.h"
+#include "Macro.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -78,8 +82,10 @@ int __attribute__((OS_main)) main(void) {
     //
     DebugInit();
     UARTInit();
+    SerialInit();
     TimerInit();
     SG3525Init();
+    TelemInit();
 
     sei();                              // Enable interrupts
 
@@ -104,12 +110,31 @@ int __attribute__((OS_main)) main(void) {
 #   endif
 
             //
-            // Process serial commands as they come in
+            // Process serial commands as they come in, or setpoints when streaming
             //
-            ProcessSerialInput(GetUARTByte());
+            if( StreamMode ) StreamPump();
+            else             ProcessSerialInput(GetUARTByte());
+
+            //
+            // Run any macro an input asked for during the tick
+            //
+            MacroUpdate();
+
+            //
+            // Send deferred output as the UART has room, telemetry first
+            //
+            TelemPump();
+            SerialPump();
+
+            //
+            // Save a new current sensor zero, outside the tick (EEPROM writes are slow)
+            //
+            ACS712Save();
             }
 
+        StreamUpdate();
         SG3525Update();
+        TelemUpdate();
         ScreenUpdate();
         }
     }
@@ -0,0 +1,340 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Stream.c - Binary setpoint stream, for host driven profiles
+//
+//  SYNOPSIS
+//
+//      See Stream.h for details
+//
+//  DESCRIPTION
+//
+//      Take setpoints from framed binary packets, with a watchdog, and report back
+//
+//  VERSION:    2015.08.30
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include <util/crc16.h>
+#include <avr/pgmspace.h>
+
+#include "PortMacros.h"
+#include "Stream.h"
+#include "Telemetry.h"
+#include "SG3525.h"
+#include "Serial.h"
+#include "UART.h"
+#include "Timer.h"
+#include "Command.h"
+#include "Screen.h"
+#include "Parse.h"
+#include "Format.h"
+#include "MAScreen.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data declarations
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#define SETPOINT_LEN    7                   // Setpoint record, before the CRC
+#define REPORT_LEN      10                  // Report record, before the CRC
+
+STREAM_STATS StreamStats;
+bool         StreamMode;                    // TRUE when in stream mode
+
+static struct {
+    uint8_t     In[SETPOINT_LEN+4];         // Frame being read, COBS encoded
+    uint8_t     InLen;                      // Bytes in In[], one more if it overflowed
+    uint8_t     Timeout;                    // Ticks allowed between setpoints
+    uint8_t     Watchdog;                   // Ticks left until stalled
+    bool        Pending;                    // Setpoint written, not yet applied
+    uint8_t     Seq;                        // Sequence of the latest setpoint
+    uint16_t    Stamp;                      // TimerGetFine() at its end of frame
+    uint8_t     Report[REPORT_LEN+5];       // Report frame, waiting to be sent
+    uint8_t     ReportLen;                  // Length of report frame, 0 if none
+    int         Screen;                     // Screen to go back to
+    } Stream NOINIT;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// StreamExit - Back to the console
+//
+// Inputs:      Reason, appended to "mode=terminal" (PROGMEM)
+//
+// Outputs:     None.
+//
+static void StreamExit(PGM_P Why) {
+
+    StreamMode = false;
+    SerialSetMute(false);
+    PrintF("\r\nmode=terminal%s\r\n",Why);
+    ShowScreen(Stream.Screen);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// StreamDecode - COBS decode and CRC check a frame, in place
+//
+// Inputs:      Frame, without the zero bytes around it
+//              Length of frame
+//
+// Outputs:     Length of record, without the CRC
+//              0 if the frame is bad
+//
+static uint8_t StreamDecode(uint8_t *Frame,uint8_t Len) {
+    uint16_t    CRC = 0xFFFF;
+    uint8_t     In  = 0;
+    uint8_t     Out = 0;
+
+    while( In < Len ) {
+        uint8_t Code = Frame[In++];
+
+        if( In + Code - 1 > Len )
+            return 0;
+
+        for( uint8_t i = 1; i < Code; i++ )
+            Frame[Out++] = Frame[In++];
+
+        if( Code != 0xFF && In < Len )
+            Frame[Out++] = 0;
+        }
+
+    if( Out < 3 )
+        return 0;
+
+    Out -= 2;
+    for( uint8_t i = 0; i < Out; i++ )
+        CRC = _crc_xmodem_update(CRC,Frame[i]);
+
+    if( Frame[Out] != (uint8_t) CRC || Frame[Out+1] != (uint8_t) (CRC >> 8) )
+        return 0;
+
+    return Out;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// StreamFrame - Act on a frame from the host
+//
+// Inputs:      None. (The frame is in Stream.In)
+//
+// Outputs:     None.
+//
+static void StreamFrame(void) {
+    uint8_t    *Record = Stream.In;
+    uint8_t     Len    = 0;
+    uint16_t    Freq;
+    uint16_t    Power;
+
+    if( Stream.InLen <= sizeof(Stream.In) )
+        Len = StreamDecode(Record,Stream.InLen);
+
+    if( Len == 1 && Record[0] == STREAM_END ) {
+        StreamExit(PSTR(""));
+        return;
+        }
+
+    Freq  = Record[2] | (Record[3] << 8);
+    Power = Record[4] | (Record[5] << 8);
+
+    if( Len != SETPOINT_LEN || Record[0] != STREAM_SETPOINT ||
+        Freq  < SG3525_MIN_FREQ  || Freq  > SG3525_MAX_FREQ ||
+        Power > SG3525_MAX_POWER ) {
+        StreamStats.Bad++;
+        return;
+        }
+
+    Stream.Stamp = TimerGetFine();
+
+    if( Stream.Pending )
+        StreamStats.Superseded++;
+    StreamStats.Received++;
+
+    SG3525Set.Freq  = Freq;
+    SG3525Set.Power = Power;
+    if( (Record[6] & 1) != (SG3525_IS_ON ? 1 : 0) )
+        SG3525Run(Record[6] & 1);
+
+    Stream.Seq      = Record[1];
+    Stream.Pending  = true;
+    Stream.Watchdog = Stream.Timeout;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// StreamPump - Read setpoint frames, and send the pending report
+//
+// Inputs:      None. (Called from the idle loop, in place of ProcessSerialInput())
+//
+// Outputs:     None.
+//
+// Everything waiting in the Rx FIFO is read, so a frame is acted on as soon as its
+//   closing zero is in.
+//
+void StreamPump(void) {
+
+    while( StreamMode && UARTAvail() ) {
+        uint8_t Byte = GetUARTByte();
+
+        if( Byte == 0 ) {
+            if( Stream.InLen )
+                StreamFrame();
+            Stream.InLen = 0;
+            continue;
+            }
+
+        if( Stream.InLen < sizeof(Stream.In) )
+            Stream.In[Stream.InLen] = Byte;
+        if( Stream.InLen <= sizeof(Stream.In) )
+            Stream.InLen++;
+        }
+
+    if( Stream.ReportLen && SerialPutFrame((char *) Stream.Report,Stream.ReportLen) )
+        Stream.ReportLen = 0;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// StreamUpdate - Check the watchdog, and report the setpoint about to be applied
+//
+// Inputs:      None. (Called every tick, before SG3525Update())
+//
+// Outputs:     None.
+//
+// A report not yet sent is replaced by the newer one. The counts in it are totals, so
+//   the host loses only the timing of the older setpoint.
+//
+void StreamUpdate(void) {
+    uint8_t     Record[REPORT_LEN+2];
+    uint32_t    Latency;
+
+    if( !StreamMode )
+        return;
+
+    if( Stream.Pending ) {
+        Latency = (uint32_t) (uint16_t) (TimerGetFine() - Stream.Stamp)*CLOCK_US;
+        if( Latency > 0xFFFF )
+            Latency = 0xFFFF;
+        if( Latency > StreamStats.MaxLatency )
+            StreamStats.MaxLatency = Latency;
+
+        Record[0] = STREAM_REPORT;
+        Record[1] = Stream.Seq;
+        Record[2] = Latency;
+        Record[3] = Latency >> 8;
+        Record[4] = StreamStats.Received;
+        Record[5] = StreamStats.Received >> 8;
+        Record[6] = StreamStats.Superseded;
+        Record[7] = StreamStats.Superseded >> 8;
+        Record[8] = StreamStats.Bad;
+        Record[9] = StreamStats.Bad >> 8;
+
+        Stream.ReportLen = TelemFrame(Record,REPORT_LEN,Stream.Report);
+        Stream.Pending   = false;
+        }
+
+    //
+    // No setpoint for too long: the host is gone, or stuck. Stop the transducer
+    //   rather than hold the last setpoint.
+    //
+    if( --Stream.Watchdog == 0 ) {
+        SG3525Run(false);
+        StreamStats.Stalls++;
+        StreamExit(PSTR(" stalled"));
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// StreamCmd - SP - Enter stream mode, or show stream statistics
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+//      SP              Stream, with the default watchdog
+//      SP #            Stream, with a watchdog of # ticks (or 200ms, 1s)
+//      SP S            Show statistics of the last stream
+//
+void StreamCmd(uint8_t Argc,char *Argv[]) {
+    uint16_t Timeout = STREAM_TIMEOUT;
+
+    if( StrEQ(Argv[1],"S") ) {
+        StartMsg();
+        PrintF("Setpoints %u, superseded %u, bad %u, stalls %u, max latency %u us",
+               StreamStats.Received,StreamStats.Superseded,StreamStats.Bad,
+               StreamStats.Stalls,StreamStats.MaxLatency);
+        return;
+        }
+
+    if( Argv[1][0] && !CommandArg(Argv[1],UNIT_TICKS,1,0xFF,&Timeout) )
+        return;
+
+    if( UARTGetFlow() ) {
+        StartMsg();
+        PrintStringP(PSTR("Turn flow control off first (FL OF)"));
+        return;
+        }
+
+    //
+    // A staged commit would overwrite the streamed setpoints at the next tick
+    //
+    if( SG3525Staged() ) {
+        StartMsg();
+        PrintStringP(PSTR("Finish staging first (ST C or ST A)"));
+        return;
+        }
+
+    memset(&StreamStats,0,sizeof(StreamStats));
+    memset(&Stream,0,sizeof(Stream));
+    Stream.Timeout  = Timeout;
+    Stream.Watchdog = Timeout;
+    Stream.Screen   = SelectedScreen;
+    StreamMode      = true;
+
+    SerialFlushLo();
+    PrintStringP(PSTR("mode=stream\r\n"));
+    SerialSetMute(true);
+    }
@@ -0,0 +1,189 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Stream.h - Binary setpoint stream, for host driven profiles
+//
+//  SYNOPSIS
+//
+//      Cmd> SP 200ms                       // Stream, stop if 200 ms without a setpoint
+//      mode=stream                         // Then binary frames, both ways
+//
+//      Cmd> SP S                           // Afterwards: stream statistics
+//
+//      //////////////////////////////////////
+//      //
+//      // In Main.c
+//      //
+//      while(1) {
+//          while( !TimerUpdate() ) {
+//              sleep_cpu();
+//              if( StreamMode ) StreamPump();  // Setpoints in, reports out
+//              else             ProcessSerialInput(GetUARTByte());
+//              ...
+//              }
+//
+//          StreamUpdate();                 // Watchdog, and time the setpoint applied
+//          SG3525Update();
+//          ...
+//          }
+//
+//  DESCRIPTION
+//
+//      A host can't drive a frequency/power profile through the console: each FR or
+//        PO line costs an echo, a prompt and a message, and is handled on the next
+//        line ending. In stream mode the host sends setpoints as short binary frames
+//        instead, and the unit reports back when each one was applied.
+//
+//      In stream mode the console is quiet, as in machine mode (see Query.h): no
+//        echo, no screen, and text output is dropped. Telemetry frames still go out.
+//        XON/XOFF flow control must be off, as frames may contain those bytes.
+//        Staging (ST) must be finished too, or its commit would overwrite the
+//        streamed setpoints.
+//
+//      A setpoint is written into SG3525Set as soon as its frame ends, and is
+//        applied by the next SG3525Update(), at most a tick (40 ms) later. If more
+//        than one arrives in a tick only the last is applied, and the others are
+//        counted as superseded. The setpoint loop runs once a tick (25 Hz), so a
+//        faster stream gains nothing but superseded setpoints.
+//
+//      The watchdog: if no good setpoint arrives for the timeout given to SP
+//        (default STREAM_TIMEOUT), the transducer is turned off and the unit goes
+//        back to the console, printing "mode=terminal stalled". An END frame goes back
+//        to the console with the output left as it is, printing "mode=terminal".
+//
+//  FRAME FORMAT
+//
+//      Frames are framed as telemetry records (see Telemetry.h): CRC-16/CCITT, COBS,
+//        and a zero byte before and after. Before COBS encoding, little endian:
+//
+//      Host to unit:
+//
+//          STREAM_SETPOINT     Byte  0     0x10
+//                              Byte  1     Sequence, chosen by the host
+//                              Bytes 2-3   Frequency, Hz
+//                              Bytes 4-5   Power, watts x 10
+//                              Byte  6     Bit 0: transducer on
+//
+//          STREAM_END          Byte  0     0x11
+//
+//      Unit to host, the tick a setpoint is applied:
+//
+//          STREAM_REPORT       Byte  0     0x12
+//                              Byte  1     Sequence of the setpoint applied
+//                              Bytes 2-3   Latency, end of frame to applied, us
+//                              Bytes 4-5   Setpoints received (wraps)
+//                              Bytes 6-7   Setpoints superseded (wraps)
+//                              Bytes 8-9   Bad frames: CRC, length, type or range
+//
+//      A setpoint out of range (see SG3525.h) is a bad frame, and is not applied.
+//
+//  LATENCY
+//
+//      At 19200 baud a setpoint frame takes 6 ms to arrive, and a report 8 ms to go
+//        out. Latency is timed in CLOCK_US (64 us) steps, from the frame's last
+//        byte being read to the start of the tick that applies it.
+//
+//  VERSION:    2015.08.30
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Default watchdog: ticks without a setpoint before the stream is called stalled
+//
+#define STREAM_TIMEOUT      5
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#define STREAM_SETPOINT     0x10            // Frame type: setpoint, host to unit
+#define STREAM_END          0x11            // Frame type: back to console, host to unit
+#define STREAM_REPORT       0x12            // Frame type: setpoint applied, unit to host
+
+typedef struct {
+    uint16_t    Received;                   // Good setpoints received
+    uint16_t    Superseded;                 // Received, but replaced before applied
+    uint16_t    Bad;                        // Bad frames
+    uint16_t    Stalls;                     // Watchdog timeouts
+    uint16_t    MaxLatency;                 // Longest end of frame to applied, us
+    } STREAM_STATS;
+
+extern STREAM_STATS StreamStats;
+extern bool         StreamMode;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// StreamPump - Read setpoint frames, and send the pending report
+//
+// Inputs:      None. (Called from the idle loop, in place of ProcessSerialInput())
+//
+// Outputs:     None.
+//
+void StreamPump(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// StreamUpdate - Check the watchdog, and report the setpoint about to be applied
+//
+// Inputs:      None. (Called every tick, before SG3525Update())
+//
+// Outputs:     None.
+//
+void StreamUpdate(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// StreamCmd - SP - Enter stream mode, or show stream statistics
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// Called from the command table in Command.c
+//
+void StreamCmd(uint8_t Argc,char *Argv[]);
+
+
+#endif  // STREAM_H - entire file
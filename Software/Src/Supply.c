@@ -0,0 +1,178 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Supply.c - Supply voltage measurement and power limiting
+//
+//  SYNOPSIS
+//
+//      See Supply.h for details
+//
+//  DESCRIPTION
+//
+//      Keep the transducer within what the supply can deliver
+//
+//  VERSION:    2015.08.22
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "Supply.h"
+#include "SG3525.h"
+#include "ADC.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data declarations
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+static struct {
+    uint16_t        PowerLimit;                     // Wiper ceiling from power limit
+    SUPPLY_STATE    State;                          // Limiting state
+    } Supply NOINIT;
+
+//
+// Per the WINAVR definition of PROGMEM, we must explicitly put each string into PROGMEM
+//   within an array separately
+//
+static char SNT1[] PROGMEM = "Full ";
+static char SNT2[] PROGMEM = "Limit";
+static char SNT3[] PROGMEM = "Sag  ";
+static char SNT4[] PROGMEM = "Low  ";
+
+static char *SupplyNameText[] = {
+    SNT1, SNT2, SNT3, SNT4
+    };
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SupplyInit - Initialize supply monitoring
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void SupplyInit(void) {
+
+    memset(&Supply,0,sizeof(Supply));
+
+    Supply.PowerLimit = PWMPot_MAX_WIPER;
+    Supply.State      = SUPPLY_FULL;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SupplyGetVcc - Return supply voltage
+//
+// Inputs:      None.
+//
+// Outputs:     Supply voltage from last tick, in volts x 10
+//
+uint16_t SupplyGetVcc(void) {
+    return (((uint32_t) ADCGetAvg(ADC_VCC))*SUPPLY_VCC_GAIN + 0x8000) >> 16;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SupplyGetState - Return supply limiting state
+//
+// Inputs:      None.
+//
+// Outputs:     Limiting state from last update
+//
+SUPPLY_STATE SupplyGetState(void) { return Supply.State; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SupplyName - Return printable name of supply state
+//
+// Inputs:      Supply state
+//
+// Outputs:     PROGMEM string, 5 chars wide
+//
+PGM_P SupplyName(SUPPLY_STATE State) { return SupplyNameText[State - SUPPLY_FULL]; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SupplyUpdate - Limit PWM wiper to protect the supply
+//
+// Inputs:      None. (Called every tick, after SG3525Curr has been updated)
+//
+// Outputs:     None.
+//
+void SupplyUpdate(void) {
+    uint16_t Vcc      = SG3525Curr.Vcc;
+    uint16_t SagLimit = PWMPot_MAX_WIPER;
+
+    //
+    // Power limit: step the ceiling down below the present wiper while over the
+    //   limit, and back up once comfortably under it.
+    //
+    if( !SG3525_IS_ON )
+        Supply.PowerLimit = PWMPot_MAX_WIPER;
+    else if( SG3525Curr.Power   > SUPPLY_MAX_POWER ||
+             SG3525Curr.Current > SUPPLY_MAX_CURRENT ) {
+        if( Supply.PowerLimit > SG3525Curr.PWMWiper )
+            Supply.PowerLimit = SG3525Curr.PWMWiper;
+        if( Supply.PowerLimit > 0 )
+            Supply.PowerLimit--;
+        }
+    else if( SG3525Curr.Power   < SUPPLY_MAX_POWER - SUPPLY_POWER_HYST &&
+             Supply.PowerLimit  < PWMPot_MAX_WIPER )
+        Supply.PowerLimit++;
+
+    //
+    // Sag derating: linear from full at DERATE_VCC to zero at MIN_VCC
+    //
+    if( Vcc < SUPPLY_MIN_VCC )
+        SagLimit = 0;
+    else if( Vcc < SUPPLY_DERATE_VCC )
+        SagLimit = (((uint32_t) PWMPot_MAX_WIPER)*(Vcc - SUPPLY_MIN_VCC))/
+                                            (SUPPLY_DERATE_VCC - SUPPLY_MIN_VCC);
+
+    if     ( Vcc < SUPPLY_MIN_VCC )                  Supply.State = SUPPLY_LOW;
+    else if( Vcc < SUPPLY_DERATE_VCC )               Supply.State = SUPPLY_SAG;
+    else if( Supply.PowerLimit < PWMPot_MAX_WIPER )  Supply.State = SUPPLY_LIMIT;
+    else                                             Supply.State = SUPPLY_FULL;
+
+    if( SG3525Curr.PWMLimit > Supply.PowerLimit ) SG3525Curr.PWMLimit = Supply.PowerLimit;
+    if( SG3525Curr.PWMLimit > SagLimit          ) SG3525Curr.PWMLimit = SagLimit;
+    }
@@ -0,0 +1,180 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Supply.h - Supply voltage measurement and power limiting
+//
+//  SYNOPSIS
+//
+//      //////////////////////////////////////
+//      //
+//      // In Supply.h
+//      //
+//      ...Choose divider resistors         (Default: 47K/10K)
+//      ...Choose supply limits             (Default: see below)
+//
+//      //////////////////////////////////////
+//      //
+//      // In SG3525.c
+//      //
+//      SupplyInit();                       // Called once at startup
+//
+//      SG3525Curr.Vcc = SupplyGetVcc();    // Supply voltage from last tick
+//
+//      SG3525Curr.PWMLimit = PWMPot_MAX_WIPER;
+//      SupplyUpdate();                     // Called every tick, after measurements
+//
+//      State = SupplyGetState();           // Limiting state, for display
+//
+//  DESCRIPTION
+//
+//      The supply voltage is measured through a resistor divider on the
+//        ADC_VCC_CHANNEL AtoD input, and is used to protect the supply:
+//
+//      Power limit:    If the measured power or current is more than the supply can
+//                        deliver, the PWM wiper ceiling is stepped down one notch per
+//                        tick. Once back under the limit (with hysteresis) it steps
+//                        back up.
+//
+//      Sag derating:   Below SUPPLY_DERATE_VCC the ceiling is scaled down linearly,
+//                        reaching zero at SUPPLY_MIN_VCC.
+//
+//      Brownout:       Below SUPPLY_MIN_VCC the fault system (Fault.c) latches a
+//                        brownout fault, which by default turns the output off.
+//
+//      The ceiling is applied by lowering SG3525Curr.PWMLimit.
+//
+//  VERSION:    2015.08.22
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SUPPLY_H
+#define SUPPLY_H
+
+#include <stdint.h>
+
+#include <avr/pgmspace.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Vcc divider: Vcc -- TOP -- AtoD -- BOT -- Gnd, in K ohms
+//
+#define SUPPLY_DIV_TOP          47
+#define SUPPLY_DIV_BOT          10
+
+//
+// What the supply can deliver
+//
+#define SUPPLY_MAX_POWER        (100*10)    // Watts x 10
+#define SUPPLY_MAX_CURRENT      100         // Amps  x 10
+#define SUPPLY_POWER_HYST       (5*10)      // Watts x 10 below limit before stepping up
+
+//
+// Supply sag: Derate below DERATE_VCC, brownout below MIN_VCC
+//
+#define SUPPLY_DERATE_VCC       110         // Volts x 10
+#define SUPPLY_MIN_VCC          90          // Volts x 10
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// Volts x 10 per Q4 AtoD count, Q16: 5V x 10 x (TOP+BOT)/BOT / (1023 x 16)
+//
+#define SUPPLY_VCC_GAIN ((50UL*65536*(SUPPLY_DIV_TOP+SUPPLY_DIV_BOT))/(SUPPLY_DIV_BOT*1023UL*16))
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Supply limiting state
+//
+typedef enum {
+    SUPPLY_FULL = 600,      // No limiting
+    SUPPLY_LIMIT,           // Power or current limited
+    SUPPLY_SAG,             // Derating for low Vcc
+    SUPPLY_LOW,             // Vcc below brownout
+    } SUPPLY_STATE;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SupplyInit - Initialize supply monitoring
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void SupplyInit(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SupplyUpdate - Limit PWM wiper to protect the supply
+//
+// Inputs:      None. (Called every tick, after SG3525Curr has been updated)
+//
+// Outputs:     None.
+//
+// NOTE: May lower SG3525Curr.PWMLimit, which the caller must reset before calling.
+//
+void SupplyUpdate(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SupplyGetVcc   - Return supply voltage
+// SupplyGetState - Return supply limiting state
+//
+// Inputs:      None.
+//
+// Outputs:     Supply voltage from last tick, in volts x 10
+//              Limiting state from last update
+//
+uint16_t     SupplyGetVcc(void);
+SUPPLY_STATE SupplyGetState(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// SupplyName - Return printable name of supply state
+//
+// Inputs:      Supply state
+//
+// Outputs:     PROGMEM string, 5 chars wide
+//
+PGM_P SupplyName(SUPPLY_STATE State);
+
+
+#endif  // SUPPLY_H - entire file
@@ -0,0 +1,496 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Telemetry.c - Binary telemetry stream, framed alongside the console
+//
+//  SYNOPSIS
+//
+//      See Telemetry.h for details
+//
+//  DESCRIPTION
+//
+//      Get machine readable data off the unit without scraping the screen
+//
+//  VERSION:    2015.08.25
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <util/crc16.h>
+#include <avr/pgmspace.h>
+
+#include "Telemetry.h"
+#include "SG3525.h"
+#include "Serial.h"
+#include "UART.h"
+#include "Timer.h"
+#include "Command.h"
+#include "Screen.h"
+#include "Parse.h"
+#include "VT100.h"
+#include "Debug.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data declarations
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+static struct {
+    uint8_t     Every[NUM_TELEM_SIGNALS];           // Ticks between samples, 0 if off
+    uint8_t     Count[NUM_TELEM_SIGNALS];           // Ticks until next sample
+    uint16_t    Last[NUM_TELEM_SIGNALS];            // Value last put in a record
+    uint8_t     KeyEvery;                           // Records between keyframes, 0 if off
+    uint8_t     KeyCount;                           // Records until next keyframe
+    bool        NeedKey;                            // TRUE if host may be out of step
+    uint16_t    Tick;                               // Timestamp, ticks since init
+    uint16_t    Credit;                             // UART bytes telemetry may still use
+    uint8_t     Len;                                // Length of pending frame, 0 if none
+    uint8_t     Frame[TELEM_MAX_FRAME];             // Pending frame
+    } Telem NOINIT;
+
+TELEM_STATS TelemStats NOINIT;
+
+//
+// Credit is capped, so that an idle stretch doesn't save up for a burst
+//
+#define TELEM_MAX_CREDIT    (2*TELEM_MAX_FRAME)
+
+//
+// Signal names and where to find them, in TELEM_SIGNAL_ID order
+//
+typedef struct {
+    char        Name[3];                            // Name used in commands
+    uint16_t   *Value;                              // Signal to sample
+    } TELEM_SIGNAL;
+
+static const TELEM_SIGNAL TelemSignals[NUM_TELEM_SIGNALS] PROGMEM = {
+    { "RT", &SG3525Curr.RunTimer   },
+    { "FR", &SG3525Curr.Freq       },
+    { "CU", &SG3525Curr.Current    },
+    { "PO", &SG3525Curr.Power      },
+    { "VC", &SG3525Curr.Vcc        },
+    { "PM", &SG3525Curr.PWM        },
+    { "PW", &SG3525Curr.PWMWiper   },
+    { "PL", &SG3525Curr.PWMLimit   },
+    { "FC", &SG3525Curr.FreqCWiper },
+    { "FF", &SG3525Curr.FreqFWiper },
+    { "D1", &Debug1                },
+    { "D2", &Debug2                },
+    { "D3", &Debug3                },
+    { "D4", &Debug4                },
+    };
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemInit - Initialize telemetry, off
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void TelemInit(void) {
+
+    memset(&Telem     ,0,sizeof(Telem));
+    memset(&TelemStats,0,sizeof(TelemStats));
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemSubscribe - Set ticks between samples of a signal
+//
+// Inputs:      Signal to set
+//              Ticks between samples, 0 to stop sending the signal
+//
+// Outputs:     None.
+//
+void TelemSubscribe(TELEM_SIGNAL_ID Signal,uint8_t Every) {
+
+    Telem.Every[Signal] = Every;
+    Telem.Count[Signal] = 1;                // First sample on the next tick
+    Telem.NeedKey       = true;             // Host has no value to add deltas to
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemSetRate - Subscribe to all the SG3525 signals at one rate
+//
+// Inputs:      Ticks between records, 0 to turn telemetry off
+//
+// Outputs:     None.
+//
+void TelemSetRate(uint8_t Every) {
+
+    for( uint8_t Signal = 0; Signal < NUM_TELEM_SIGNALS; Signal++ ) {
+        if( Signal < TELEM_DEBUG1 || Every == 0 )
+            TelemSubscribe(Signal,Every);
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemSetKey - Set delta encoding, and records between keyframes
+//
+// Inputs:      Records between keyframes, 0 to send full values in every record
+//
+// Outputs:     None.
+//
+void TelemSetKey(uint8_t Every) {
+
+    Telem.KeyEvery = Every;
+    Telem.NeedKey  = true;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemVarint - Zigzag and varint encode a signal change
+//
+// Inputs:      Where to put the encoded change (up to 3 bytes)
+//              Change in signal, modulo 2^16
+//
+// Outputs:     Number of bytes used
+//
+static uint8_t TelemVarint(uint8_t *Out,uint16_t Delta) {
+    uint16_t    Zig = (Delta << 1) ^ ((Delta & 0x8000) ? 0xFFFF : 0);
+    uint8_t     Len = 0;
+
+    while( Zig >= 0x80 ) {
+        Out[Len++] = Zig | 0x80;
+        Zig      >>= 7;
+        }
+
+    Out[Len++] = Zig;
+
+    return Len;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemFrame - CRC, COBS encode and frame a record
+//
+// Inputs:      Record to frame, with 2 bytes of room after it for the CRC
+//              Length of record
+//              Where to put the frame (at least Len+5 bytes)
+//
+// Outputs:     Length of frame
+//
+uint8_t TelemFrame(uint8_t *Record,uint8_t Len,uint8_t *Frame) {
+    uint16_t    CRC = 0xFFFF;
+    uint8_t     Code;
+    uint8_t     CodeIndex;
+    uint8_t     FrameLen;
+
+    for( uint8_t i = 0; i < Len; i++ )
+        CRC = _crc_xmodem_update(CRC,Record[i]);
+
+    Record[Len++] = CRC;
+    Record[Len++] = CRC >> 8;
+
+    //
+    // COBS: replace each zero with the distance to the next one
+    //
+    Frame[0]  = 0;
+    Code      = 1;
+    CodeIndex = 1;
+    FrameLen  = 2;
+
+    for( uint8_t i = 0; i < Len; i++ ) {
+        if( Record[i] == 0 ) {
+            Frame[CodeIndex] = Code;
+            CodeIndex        = FrameLen++;
+            Code             = 1;
+            }
+        else {
+            Frame[FrameLen++] = Record[i];
+            if( ++Code == 0xFF ) {
+                Frame[CodeIndex] = Code;
+                CodeIndex        = FrameLen++;
+                Code             = 1;
+                }
+            }
+        }
+
+    Frame[CodeIndex]  = Code;
+    Frame[FrameLen++] = 0;
+
+    return FrameLen;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemUpdate - Build a telemetry record, if one is due
+//
+// Inputs:      None. (Called every tick, after SG3525Update())
+//
+// Outputs:     None.
+//
+void TelemUpdate(void) {
+    uint8_t  Record[TELEM_MAX_RECORD+2];
+    uint8_t  Len  = 5;
+    uint16_t Mask = 0;
+    uint16_t All  = 0;
+    bool     Key;
+
+    Telem.Tick++;
+
+    //
+    // Earn this tick's share of the UART bandwidth, at 10 bits per byte
+    //
+    Telem.Credit += (UARTGetBaud()*TELEM_BUDGET)/(10UL*100*TICKS_PER_SEC);
+    if( Telem.Credit > TELEM_MAX_CREDIT )
+        Telem.Credit = TELEM_MAX_CREDIT;
+
+    //
+    // Find the signals that are due
+    //
+    for( uint8_t Signal = 0; Signal < NUM_TELEM_SIGNALS; Signal++ ) {
+
+        if( Telem.Every[Signal] == 0 )
+            continue;
+
+        All |= 1 << Signal;
+
+        if( --Telem.Count[Signal] )
+            continue;
+
+        Telem.Count[Signal] = Telem.Every[Signal];
+        Mask               |= 1 << Signal;
+        }
+
+    if( Mask == 0 )
+        return;
+
+    //
+    // A keyframe sends every subscribed signal in full. It's also needed if the
+    //   pending record is about to be replaced, since the host never saw it.
+    //
+    Key = false;
+    if( Telem.KeyEvery ) {
+        if( Telem.NeedKey || Telem.Len || --Telem.KeyCount == 0 ) {
+            Key            = true;
+            Mask           = All;
+            Telem.KeyCount = Telem.KeyEvery;
+            Telem.NeedKey  = false;
+            }
+        }
+
+    //
+    // Pack the signals
+    //
+    for( uint8_t Signal = 0; Signal < NUM_TELEM_SIGNALS; Signal++ ) {
+
+        if( !(Mask & (1 << Signal)) )
+            continue;
+
+        uint16_t Value = *(uint16_t *) pgm_read_word(&TelemSignals[Signal].Value);
+
+        if( Telem.KeyEvery && !Key )
+            Len += TelemVarint(Record+Len,Value - Telem.Last[Signal]);
+        else {
+            Record[Len++] = Value;
+            Record[Len++] = Value >> 8;
+            }
+
+        Telem.Last[Signal] = Value;
+        }
+
+    Record[0] = (Telem.KeyEvery && !Key) ? TELEM_DELTA : TELEM_SIGNALS;
+    Record[1] = Telem.Tick;
+    Record[2] = Telem.Tick >> 8;
+    Record[3] = Mask;
+    Record[4] = Mask >> 8;
+
+    //
+    // Skipping a record puts the host out of step, until the next keyframe
+    //
+    if( Telem.Credit < Len+5 ) {
+        TelemStats.Skipped++;
+        Telem.NeedKey = true;
+        return;
+        }
+
+    //
+    // A record not yet sent is stale now, replace it
+    //
+    if( Telem.Len )
+        TelemStats.Skipped++;
+
+    Telem.Len     = TelemFrame(Record,Len,Telem.Frame);
+    Telem.Credit -= Telem.Len;
+
+    TelemPump();
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemPump - Send the pending record, when the console allows
+//
+// Inputs:      None. (Called from the idle loop)
+//
+// Outputs:     None.
+//
+void TelemPump(void) {
+
+    if( Telem.Len && SerialPutFrame((char *) Telem.Frame,Telem.Len) ) {
+        Telem.Len = 0;
+        TelemStats.Sent++;
+        }
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemOn - Return TRUE if any signal is subscribed
+//
+// Inputs:      None.
+//
+// Outputs:     TRUE if telemetry frames are being sent
+//
+bool TelemOn(void) {
+
+    for( uint8_t Signal = 0; Signal < NUM_TELEM_SIGNALS; Signal++ )
+        if( Telem.Every[Signal] )
+            return true;
+
+    return false;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemCmd - TM - Show or set telemetry subscriptions
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// TM       - Show telemetry subscriptions
+// TM #     - All SG3525 signals every # ticks, 0 for off
+// TM xx #  - Signal xx every # ticks, 0 to stop sending it
+// TM KF #  - Delta encode, keyframe every # records, 0 for full values
+//
+void TelemCmd(uint8_t Argc,char *Argv[]) {
+    char   *RateText = Argv[1];
+    uint8_t Signal   = NUM_TELEM_SIGNALS;
+    bool    KeyCmd   = false;
+
+    if( StrEQ(RateText,"KF") ) {
+        KeyCmd   = true;
+        RateText = Argv[2];
+        }
+    else if( RateText[0] && !isdigit(RateText[0]) ) {
+        for( Signal = 0; Signal < NUM_TELEM_SIGNALS; Signal++ ) {
+            char Name[sizeof(TelemSignals[0].Name)];
+
+            memcpy_P(Name,TelemSignals[Signal].Name,sizeof(Name));
+            if( StrEQ(RateText,Name) )
+                break;
+            }
+
+        if( Signal == NUM_TELEM_SIGNALS ) {
+            CursorPos(1,ERROR_ROW);
+            ClearEOL;
+            PrintStringP(PSTR("Bad telemetry signal ("));
+            PrintString(RateText);
+            PrintStringP(PSTR("), must be RT FR CU PO VC PM PW PL FC FF D1-D4\r\n"));
+            PrintStringP(PSTR("Type '?' for help\r\n"));
+            return;
+            }
+
+        RateText = Argv[2];
+        }
+
+    if( RateText[0] ) {
+        uint16_t RateNum;
+
+        if( !CommandArg(RateText,UNIT_TICKS,0,255,&RateNum) )
+            return;
+
+        //
+        // Frames may contain XON and XOFF bytes, which the host's flow control eats
+        //
+        if( RateNum && !KeyCmd && UARTGetFlow() ) {
+            CursorPos(1,ERROR_ROW);
+            ClearEOL;
+            PrintStringP(PSTR("Turn flow control off first (FL OF)\r\n"));
+            return;
+            }
+
+        if     ( KeyCmd                     ) TelemSetKey(RateNum);
+        else if( Signal < NUM_TELEM_SIGNALS ) TelemSubscribe(Signal,RateNum);
+        else                                  TelemSetRate(RateNum);
+        }
+
+    bool Any = false;
+
+    CursorPos(1,ERROR_ROW);
+    ClearEOL;
+    PrintStringP(PSTR("Telemetry"));
+    for( Signal = 0; Signal < NUM_TELEM_SIGNALS; Signal++ ) {
+        if( Telem.Every[Signal] ) {
+            PrintChar(' ');
+            PrintStringP(TelemSignals[Signal].Name);
+            PrintChar('/');
+            PrintD(Telem.Every[Signal],0);
+            Any = true;
+            }
+        }
+    if( !Any )
+        PrintStringP(PSTR(" off"));
+    if( Telem.KeyEvery ) {
+        PrintStringP(PSTR(", KF/"));
+        PrintD(Telem.KeyEvery,0);
+        }
+    PrintStringP(PSTR(", sent "));
+    PrintD(TelemStats.Sent,0);
+    PrintStringP(PSTR(", skipped "));
+    PrintD(TelemStats.Skipped,0);
+    }
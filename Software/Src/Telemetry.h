@@ -0,0 +1,315 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Telemetry.h - Binary telemetry stream, framed alongside the console
+//
+//  SYNOPSIS
+//
+//      //////////////////////////////////////
+//      //
+//      // In Telemetry.h
+//      //
+//      ...Choose UART bandwidth budget     (Default: 50%)
+//
+//      //////////////////////////////////////
+//      //
+//      // In Main.c
+//      //
+//      TelemInit();                        // Called once at startup
+//
+//      while(1) {
+//          while( !TimerUpdate() ) {
+//              sleep_cpu();
+//              TelemPump();                // Send pending record, between text
+//              SerialPump();
+//              }
+//
+//          SG3525Update();
+//          TelemUpdate();                  // Build record, if one is due
+//          }
+//
+//      TelemSetRate(5);                    // All SG3525 signals every 5 ticks
+//
+//      TelemSubscribe(TELEM_CURRENT,1);    // Current every tick
+//      TelemSubscribe(TELEM_FREQ,25);      // Frequency once a second
+//      TelemSubscribe(TELEM_FREQ,0);       // Stop sending frequency
+//
+//      TelemSetKey(25);                    // Delta encode, keyframe every 25 records
+//      TelemSetKey(0);                     // Full values in every record
+//
+//      TelemCmd(Argc,Argv);                // TM command line, from the command table
+//
+//  DESCRIPTION
+//
+//      Scraping the VT100 screen gets 1 Hz data at roughly 10 bytes of escape codes
+//        per useful byte. Instead, the telemetry stream sends packed binary records
+//        of selected signals, mixed in with the console text.
+//
+//      Each signal (the SG3525Curr fields, and the debug probes) has its own
+//        subscription: a decimation factor N, to send it every Nth tick, or 0 to not
+//        send it at all. Each tick the due signals are packed into one record, so
+//        slow signals ride along with fast ones, and signals nobody asked for cost
+//        nothing. No record is sent on a tick with nothing due.
+//
+//      Each record is protected by a CRC and COBS encoded, so it contains no zero
+//        bytes, and is sent with a zero byte before and after it. A host splits the
+//        input at zero bytes: pieces that decode with a good CRC are records, and
+//        anything else is console text (which never contains a zero byte).
+//
+//      Frames may contain XON and XOFF bytes, so XON/XOFF flow control must be off
+//        while telemetry is on. TM refuses to start with FL ON, and FL ON refuses
+//        while any signal is subscribed.
+//
+//      Records go into the UART only between text records (see SerialPutFrame()),
+//        after any pending command replies. If a record can't be sent before the next
+//        one is due, it is replaced by the newer one.
+//
+//      Telemetry is also held to TELEM_BUDGET percent of the UART bandwidth. Each
+//        tick adds that share of a tick's worth of bytes to a credit, and a record is
+//        built only if the credit covers it. Records that don't fit are skipped.
+//
+//      Most signals change by only a few counts per tick, so optionally records can
+//        carry the change in each signal since it was last sent, in as few bytes as
+//        it takes (usually one). A keyframe of full values for every subscribed
+//        signal is sent every N records, and also after a subscription changes or a
+//        record is skipped, so a host that loses a record is back in step by the
+//        next keyframe.
+//
+//  RECORD FORMAT
+//
+//      Before COBS encoding, all values little endian:
+//
+//          Byte  0         Record type (TELEM_SIGNALS)
+//          Bytes 1-2       Timestamp, ticks since startup (wraps)
+//          Bytes 3-4       Mask of signals in record, bit N for TELEM_SIGNAL_ID N
+//          Bytes 5-        One word per signal in mask, lowest bit first
+//          Last 2 bytes    CRC-16/CCITT (poly 0x1021, init 0xFFFF) of the above
+//
+//      A delta record is the same, but with type TELEM_DELTA, and each signal is
+//        the change since its last value sent (modulo 2^16). The change is zigzag
+//        encoded (0,-1,1,-2,2... become 0,1,2,3,4...) and then sent 7 bits per byte,
+//        low bits first, with the top bit set on all but the last byte:
+//
+//          Zig   = (Delta << 1) ^ (Delta < 0 ? 0xFFFF : 0)
+//          Delta = (Zig >> 1) ^ -(Zig & 1)
+//
+//      A host keeps the last value of each signal, replaces it from TELEM_SIGNALS
+//        records, and adds to it from TELEM_DELTA records. Until the first keyframe
+//        (and after a bad CRC, until the next one) delta records are ignored.
+//
+//      COBS: each run of nonzero bytes is preceded by a count byte of (length+1),
+//        and the zero that followed the run is dropped. A count of 0xFF means a run
+//        of 254 with no zero following.
+//
+//  VERSION:    2015.08.25
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Percent of the UART bandwidth telemetry may use. The rest is left for command
+//   replies and the screen.
+//
+#define TELEM_BUDGET        50
+
+//
+// Longest record, before CRC and framing: header and every signal, at 3 bytes for
+//   the worst delta
+//
+#define TELEM_MAX_RECORD    (5+3*NUM_TELEM_SIGNALS)
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#define TELEM_SIGNALS       0x02            // Record type: mask and signals
+#define TELEM_DELTA         0x03            // Record type: mask and signal changes
+
+//
+// Signals that can be subscribed to. The order is the bit order of the record mask,
+//   and the order the signals appear in the record.
+//
+typedef enum {
+    TELEM_RUNTIMER = 0,                     // SG3525Curr.RunTimer
+    TELEM_FREQ,                             // SG3525Curr.Freq
+    TELEM_CURRENT,                          // SG3525Curr.Current
+    TELEM_POWER,                            // SG3525Curr.Power
+    TELEM_VCC,                              // SG3525Curr.Vcc
+    TELEM_PWM,                              // SG3525Curr.PWM
+    TELEM_PWM_WIPER,                        // SG3525Curr.PWMWiper
+    TELEM_PWM_LIMIT,                        // SG3525Curr.PWMLimit
+    TELEM_FREQC_WIPER,                      // SG3525Curr.FreqCWiper
+    TELEM_FREQF_WIPER,                      // SG3525Curr.FreqFWiper
+    TELEM_DEBUG1,                           // Debug probes
+    TELEM_DEBUG2,
+    TELEM_DEBUG3,
+    TELEM_DEBUG4,
+    NUM_TELEM_SIGNALS
+    } TELEM_SIGNAL_ID;
+
+//
+// Framed length: zero, COBS count byte, record, CRC, zero. (Records are short enough
+//   to need only one COBS count byte of overhead.)
+//
+#define TELEM_MAX_FRAME     (TELEM_MAX_RECORD+5)
+
+typedef struct {
+    uint16_t    Sent;                       // Records sent
+    uint16_t    Skipped;                    // Records skipped, over budget or replaced
+    } TELEM_STATS;
+
+extern TELEM_STATS TelemStats;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemInit - Initialize telemetry, off
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void TelemInit(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemUpdate - Build a telemetry record, if one is due
+//
+// Inputs:      None. (Called every tick, after SG3525Update())
+//
+// Outputs:     None.
+//
+void TelemUpdate(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemPump - Send the pending record, when the console allows
+//
+// Inputs:      None. (Called from the idle loop)
+//
+// Outputs:     None.
+//
+void TelemPump(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemSubscribe - Set ticks between samples of a signal
+//
+// Inputs:      Signal to set
+//              Ticks between samples, 0 to stop sending the signal
+//
+// Outputs:     None.
+//
+void TelemSubscribe(TELEM_SIGNAL_ID Signal,uint8_t Every);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemSetRate - Subscribe to all the SG3525 signals at one rate
+//
+// Inputs:      Ticks between records, 0 to turn telemetry off
+//
+// Outputs:     None.
+//
+// NOTE: Turning telemetry off also drops the debug probe subscriptions.
+//
+void TelemSetRate(uint8_t Every);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemSetKey - Set delta encoding, and records between keyframes
+//
+// Inputs:      Records between keyframes, 0 to send full values in every record
+//
+// Outputs:     None.
+//
+void TelemSetKey(uint8_t Every);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemFrame - CRC, COBS encode and frame a record
+//
+// Inputs:      Record to frame, with 2 bytes of room after it for the CRC
+//              Length of record
+//              Where to put the frame (at least Len+5 bytes)
+//
+// Outputs:     Length of frame
+//
+// Also frames the setpoint stream reports (see Stream.h).
+//
+uint8_t TelemFrame(uint8_t *Record,uint8_t Len,uint8_t *Frame);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemOn - Return TRUE if any signal is subscribed
+//
+// Inputs:      None.
+//
+// Outputs:     TRUE if telemetry frames are being sent
+//
+bool TelemOn(void);
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TelemCmd - TM - Show or set telemetry subscriptions
+//
+// Inputs:      Number of tokens in the command line
+//              Tokens, Argv[0] is the command name in upper case
+//
+// Outputs:     None.
+//
+// Called from the command table in Command.c
+//
+void TelemCmd(uint8_t Argc,char *Argv[]);
+
+
+#endif  // TELEMETRY_H - entire file
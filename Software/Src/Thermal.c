@@ -0,0 +1,155 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Thermal.c - Board temperature and thermal derating
+//
+//  SYNOPSIS
+//
+//      See Thermal.h for details
+//
+//  DESCRIPTION
+//
+//      Back off the power as the board heats up
+//
+//  VERSION:    2015.08.23
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+
+#include "Thermal.h"
+#include "SG3525.h"
+#include "ADC.h"
+#include "EEPROM.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data declarations
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+static struct {
+    int16_t     Temp;                               // Last temperature, degrees C
+    uint8_t     Ticks;                              // Ticks until next reading
+    } Thermal NOINIT;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ThermalInit - Initialize temperature monitoring
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void ThermalInit(void) {
+
+    memset(&Thermal,0,sizeof(Thermal));
+
+    Thermal.Ticks = 1;                      // Take a reading right away
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ThermalUpdate - Sample temperature, and derate PWM wiper ceiling
+//
+// Inputs:      None. (Called every tick)
+//
+// Outputs:     None.
+//
+void ThermalUpdate(void) {
+    uint16_t Ceiling = PWMPot_MAX_WIPER;
+
+    //
+    // Ask the AtoD for an occasional reading. The result shows up in the slot
+    //   average a tick or so later.
+    //
+    if( --Thermal.Ticks == 0 ) {
+        ADCRequest(ADC_TEMP);
+        Thermal.Ticks = THERMAL_SAMPLE_TICKS;
+        }
+
+    if( ADCGetAvg(ADC_TEMP) == 0 )          // No reading yet
+        return;
+
+    int16_t Delta = ADCGetAvg(ADC_TEMP) - EEPROM.ThermalCal.Offset;
+
+    Thermal.Temp = (((int32_t) Delta)*THERMAL_GAIN) >> 11;
+
+    //
+    // Derate linearly from full at DERATE_TEMP to zero at TRIP_TEMP
+    //
+    if( Thermal.Temp >= THERMAL_TRIP_TEMP )
+        Ceiling = 0;
+    else if( Thermal.Temp > THERMAL_DERATE_TEMP )
+        Ceiling = (((uint32_t) PWMPot_MAX_WIPER)*(THERMAL_TRIP_TEMP - Thermal.Temp))/
+                                            (THERMAL_TRIP_TEMP - THERMAL_DERATE_TEMP);
+
+    if( SG3525Curr.PWMLimit > Ceiling )
+        SG3525Curr.PWMLimit = Ceiling;
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ThermalGetTemp - Return board temperature
+//
+// Inputs:      None.
+//
+// Outputs:     Temperature from last reading, in degrees C
+//
+int16_t ThermalGetTemp(void) { return Thermal.Temp; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ThermalSetTemp - Calibrate offset against a known temperature
+//
+// Inputs:      Actual board temperature, degrees C
+//
+// Outputs:     TRUE  if the offset was set and saved to EEPROM
+//              FALSE if there is no temperature reading yet
+//
+bool ThermalSetTemp(int16_t Temp) {
+
+    if( ADCGetAvg(ADC_TEMP) == 0 )          // No reading yet
+        return false;
+
+    EEPROM.ThermalCal.Offset = ADCGetAvg(ADC_TEMP) - (((int32_t) Temp) << 11)/THERMAL_GAIN;
+    EEPROMWriteField(EEPROM.ThermalCal);
+
+    Thermal.Temp = Temp;
+    return true;
+    }
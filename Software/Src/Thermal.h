@@ -0,0 +1,167 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//      Copyright (C) 2015 Peter Walsh, Milford, NH 03055
+//      All Rights Reserved under the MIT license as outlined below.
+//
+//  FILE
+//      Thermal.h - Board temperature and thermal derating
+//
+//  SYNOPSIS
+//
+//      //////////////////////////////////////
+//      //
+//      // In Thermal.h
+//      //
+//      ...Choose derate and trip temps     (Default: 60C/80C)
+//      ...Choose sample interval           (Default: 1 second)
+//
+//      //////////////////////////////////////
+//      //
+//      // In SG3525.c
+//      //
+//      ThermalInit();                      // Called once at startup
+//
+//      SG3525Curr.PWMLimit = PWMPot_MAX_WIPER;
+//      ThermalUpdate();                    // Called every tick
+//
+//      Temp = ThermalGetTemp();            // Board temp, degrees C
+//
+//      ThermalSetTemp(Temp);               // Calibrate offset against known temp
+//
+//  DESCRIPTION
+//
+//      The ATmega328P has an internal temperature sensor on AtoD input 8, read
+//        against the internal 1.1V reference. Every THERMAL_SAMPLE_TICKS a one-shot
+//        visit to the sensor is requested from the AtoD scheduler (ADC.c), so the
+//        reading is interrupt driven and never blocks.
+//
+//      The sensor is roughly 1 count per degree C, but the offset varies by several
+//        degrees from chip to chip. The offset (Q4 counts at 0C) is calibrated and
+//        kept in EEPROM (THERMAL_CAL), and the gain (degrees per count, Q7) is the
+//        nominal THERMAL_GAIN:
+//
+//          Temp = ((Counts - Offset) * THERMAL_GAIN) >> 11
+//
+//      Above THERMAL_DERATE_TEMP the PWM wiper ceiling is scaled down linearly,
+//        reaching zero at THERMAL_TRIP_TEMP. At the trip temperature the fault
+//        system (Fault.c) latches an overtemp fault, which by default turns the
+//        output off.
+//
+//  VERSION:    2015.08.23
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+//  MIT LICENSE
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy of
+//    this software and associated documentation files (the "Software"), to deal in
+//    the Software without restriction, including without limitation the rights to
+//    use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+//    of the Software, and to permit persons to whom the Software is furnished to do
+//    so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//    all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+//    INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+//    PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+//    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+//    OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//    SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef THERMAL_H
+#define THERMAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Derate above DERATE_TEMP, trip at TRIP_TEMP (degrees C)
+//
+#define THERMAL_DERATE_TEMP     60
+#define THERMAL_TRIP_TEMP       80
+
+#define THERMAL_SAMPLE_TICKS    25          // ~1 second between readings
+
+//
+// Nominal calibration from the datasheet: 314 counts at 25C, 1 count per degree. Only
+//   the offset is calibrated (TC): the gain varies much less from chip to chip, and
+//   a one-point calibration can't find it.
+//
+#define THERMAL_DEF_OFFSET      ((314-25)*16)   // Q4 counts at 0C
+#define THERMAL_GAIN            128             // 1.0 degrees per count, Q7
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// Per-chip calibration, kept in EEPROM
+//
+typedef struct {
+    uint16_t    Offset;                             // Reading at 0C, Q4 counts
+    } THERMAL_CAL;
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ThermalInit - Initialize temperature monitoring
+//
+// Inputs:      None.
+//
+// Outputs:     None.
+//
+void ThermalInit(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ThermalUpdate - Sample temperature, and derate PWM wiper ceiling
+//
+// Inputs:      None. (Called every tick)
+//
+// Outputs:     None.
+//
+// NOTE: May lower SG3525Curr.PWMLimit, which the caller must reset before calling.
+//
+void ThermalUpdate(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ThermalGetTemp - Return board temperature
+//
+// Inputs:      None.
+//
+// Outputs:     Temperature from last reading, in degrees C
+//
+int16_t ThermalGetTemp(void);
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// ThermalSetTemp - Calibrate offset against a known temperature
+//
+// Inputs:      Actual board temperature, degrees C
+//
+// Outputs:     TRUE  if the offset was set and saved to EEPROM
+//              FALSE if there is no temperature reading yet
+//
+bool ThermalSetTemp(int16_t Temp);
+
+
+#endif  // THERMAL_H - entire file
@@ -53,6 +53,7 @@ static struct {
     TIME_T      Seconds;                            // Seconds since init
     uint16_t    MS;                                 // MS within second
     uint16_t    Countdown;                          // Interrupt count
+    uint16_t    Counts;                             // Timer counts, at last interrupt
     bool        Changed;                            // Set TRUE at each tick
     } Timer NOINIT;
 
@@ -69,6 +70,8 @@ static struct {
 #define TIMSKx      _TIMSK(TIMER_ID)
 #define OCRAx       _OCRA(TIMER_ID)
 #define OCIEAx      _OCIEA(TIMER_ID)
+#define TIFRx       _TIFR(TIMER_ID)
+#define OCFAx       _OCFA(TIMER_ID)
 
 #define DISABLE_INT _CLR_BIT(TIMSKx,OCIEAx)
 #define ENABLE_INT  _SET_BIT(TIMSKx,OCIEAx)
@@ -171,6 +174,32 @@ uint16_t TimerGetMS(void) {
     return Rtnval;
     }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TimerGetFine - Return a fine timestamp, for timing things shorter than a tick
+//
+// Inputs:      None.
+//
+// Outputs:     Timer counts (CLOCK_US each) since TimerInit(), wrapping
+//
+// If the counter has just wrapped and the interrupt hasn't run yet, its counts are
+//   added here instead.
+//
+uint16_t TimerGetFine(void) {
+    uint16_t Counts;
+    uint8_t  Count;
+
+    DISABLE_INT;                    // Disable interrupts
+    Counts = Timer.Counts;
+    Count  = TCNTx;
+    if( _BIT_ON(TIFRx,OCFAx) && Count < CLOCK_COUNT/2 )
+        Counts += CLOCK_COUNT;
+    ENABLE_INT;                     // Allow interrupts
+
+    return Counts + Count;
+    }
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -185,6 +214,8 @@ uint16_t TimerGetMS(void) {
 //
 ISR(TIMER_ISR,ISR_NOBLOCK) {
 
+    Timer.Counts += CLOCK_COUNT;
+
     if( --Timer.Countdown != 0 )
         return;
 
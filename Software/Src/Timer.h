@@ -188,6 +188,7 @@
 #define CLOCK_COUNT     125
 #define TIMER_COUNT     5
 #define TICKS_PER_SEC   25
+#define CLOCK_US        64                          // Microseconds per count (1024/F_CPU)
 
 //
 // Polled mode/ISR mode depends on the next definition.
@@ -258,6 +259,18 @@ bool TimerUpdate(void);
 TIME_T      TimerGetSeconds(void);
 uint16_t    TimerGetMS(void);
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// TimerGetFine - Return a fine timestamp, for timing things shorter than a tick
+//
+// Inputs:      None.
+//
+// Outputs:     Timer counts (CLOCK_US each) since TimerInit(), wrapping every 65536
+//                counts (4.2 seconds at 64 us). Only differences are meaningful.
+//
+uint16_t TimerGetFine(void);
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
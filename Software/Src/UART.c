@@ -19,6 +19,10 @@
 //
 //      If( UARTBusy() ) ...                // TRUE if sending something
 //
+//      if( UARTSetBaud(500000) ) ...       // Change baud rate, TRUE if attainable
+//
+//      UARTSetFlow(true);                  // Turn on XON/XOFF flow control
+//
 //  DESCRIPTION
 //
 //      A simple serial Rx/Tx driver module for interrupt driven communications
@@ -33,13 +37,13 @@
 //
 //      The baud rate and FIFO sizes can be set in the UART.h file
 //
+//      Rx errors are counted, and XON/XOFF flow control is available. See UART.h
+//
 //  NOTES:
 //
 //      This interface WILL NOT receive a NUL character (ascii 0). This is on
 //        purpose, to make for a simple interface.
 //
-//      This interface DOES NOT detect UART or overflow errors.
-//
 //      These are not the putc() and getc() functions required for stdio
 //        by WinAVR. See serial.h for those.
 //
@@ -73,24 +77,43 @@
 #include <string.h>
 
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 
 #include "PortMacros.h"
 #include "UART.h"
+#include "Ring.h"
 
 //////////////////////////////////////////////////////////////////////////////////////////
+//
+// The Rx FIFO is filled by the ISR and emptied by the main code, and the Tx FIFO the
+//   other way around, so neither needs interrupts disabled (see Ring.h).
+//
+// The flow control flags are single bytes, so each access is atomic. Throttled is set
+//   by the Rx ISR only when the FIFO is nearly full, and cleared by the main code only
+//   once it has drained, so the two never contend.
+//
+static struct {
+    RING_T(char,IFIFO_SIZE) Rx_FIFO;
+    RING_T(char,OFIFO_SIZE) Tx_FIFO;
+    uint32_t        Baud;                   // Baud rate, as requested
+    bool            Flow;                   // TRUE if XON/XOFF flow control on
+    volatile bool   Stopped;                // TRUE if host sent XOFF
+    volatile bool   Throttled;              // TRUE if we sent XOFF
+    volatile char   FlowChar;               // XON/XOFF to send next, or NUL
+    } UART NOINIT;
 
-#define IFIFO_WRAP  (IFIFO_SIZE-1)      // Wraparound mask for Rx
-#define OFIFO_WRAP  (OFIFO_SIZE-1)      // Wraparound mask for Tx
+UART_STATS UARTStats NOINIT;
 
-static struct {
-    char    Rx_FIFO[IFIFO_SIZE];
-    char    Tx_FIFO[OFIFO_SIZE];
+//
+// TXC0 is cleared by writing a 1, and the error flags must be written as zero
+//
+#define CLEAR_TXC   { UCSR0A = (UCSR0A & (_PIN_MASK(U2X0) | _PIN_MASK(MPCM0))) | \
+                                _PIN_MASK(TXC0); }
 
-    uint8_t Tx_FIFO_In;                 // FIFO input  pointer
-    uint8_t Tx_FIFO_Out;                // FIFO output pointer
-    uint8_t Rx_FIFO_In;                 // FIFO input  pointer
-    uint8_t Rx_FIFO_Out;                // FIFO output pointer
-    } UART NOINIT;
+//
+// Start the Tx ISR, to send from the FIFO or a flow control char
+//
+#define START_TX    _SET_BIT(UCSR0B,UDRIE0)
 
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -98,7 +121,7 @@ static struct {
 //
 // UARTInit - Initialize serial port
 //
-// This routine initializes the UART to BAUDRATE/7,1,n. Called from init. Also
+// This routine initializes the UART to BAUD/8,1,n. Called from init. Also
 //   enables the Rx interrupts, disables the Tx interrupt and clears the FIFOs.
 //
 // Inputs:      None.
@@ -108,21 +131,18 @@ static struct {
 void UARTInit(void) {
 
     memset(&UART,0,sizeof(UART));
+    memset(&UARTStats,0,sizeof(UARTStats));
+    RING_INIT(UART.Rx_FIFO);
+    RING_INIT(UART.Tx_FIFO);
+
+    UART.Flow = UART_FLOW;
 
     _CLR_BIT(PRR,PRUSART0);             // Power up the UART
 
     //
-    // Set the baud rate
+    // Set the baud rate. The transmitter isn't enabled yet, so this doesn't wait.
     //
-#include <util/setbaud.h>
-
-    UBRR0H = UBRRH_VALUE;
-    UBRR0L = UBRRL_VALUE;
-#if USE_2X
-    _SET_BIT(UCSR0A,U2X0);
-#else
-    _CLR_BIT(UCSR0A,U2X0);
-#endif
+    UARTSetBaud(BAUD);
 
     //
     // Enable port I/O and Rx interrupt
@@ -153,28 +173,75 @@ void UARTInit(void) {
 //              FALSE if buffer full
 //
 bool PutUARTByte(char OutChar) {
-    uint8_t NewIn;
-    bool    Success = false;
-
-    _CLR_BIT(UCSR0B,UDRIE0);                    // Disable UART interrupts
 
     //
     // If there's room in the buffer, add the new char
     //
-    NewIn = (UART.Tx_FIFO_In+1) & OFIFO_WRAP;
+    if( RING_FULL(UART.Tx_FIFO) )
+        return(false);
+
+    RING_PUT(UART.Tx_FIFO,OutChar);
+
+    START_TX;                                   // Enable UART interrupts
 
-    if( NewIn != UART.Tx_FIFO_Out ) {
-        UART.Tx_FIFO[UART.Tx_FIFO_In] = OutChar;
-        UART.Tx_FIFO_In               = NewIn;
-        Success = true;
+    return(true);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PutUARTRun - Send a run of chars out the serial port
+//
+// Reserve as much FIFO space as the run needs (or as is free), copy the chars in, and
+//   then hand them all to the ISR with one update of the FIFO input pointer.
+//
+// Inputs:      Chars to send
+//              Number of chars
+//              TRUE if chars are in PROGMEM
+//
+// Outputs:     Number of chars sent, which is less than Len if the FIFO filled
+//
+static uint8_t PutUARTRun(const char *Block,uint8_t Len,bool Flash) {
+    uint8_t In;
+    uint8_t Sent;
+
+    if( Len > RING_FREE(UART.Tx_FIFO) )
+        Len = RING_FREE(UART.Tx_FIFO);
+
+    if( Len == 0 )
+        return(0);
+
+    In = UART.Tx_FIFO.In;
+    for( Sent = 0; Sent < Len; Sent++ ) {
+        UART.Tx_FIFO.Buf[In] = Flash ? pgm_read_byte(Block++) : *Block++;
+        In = RING_NEXT(UART.Tx_FIFO,In);
         }
 
-    _SET_BIT(UCSR0B,UDRIE0);                    // Enable UART interrupts
+    RING_BARRIER;
+    UART.Tx_FIFO.In = In;
 
-    return(Success);
+    START_TX;                                   // Enable UART interrupts
+
+    return(Len);
     }
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// PutUARTBlock  - Send a block of RAM     chars out the serial port
+// PutUARTBlockP - Send a block of PROGMEM chars out the serial port
+//
+// Inputs:      Chars to send
+//              Number of chars
+//
+// Outputs:     Number of chars sent, which is less than Len if the FIFO filled
+//
+uint8_t PutUARTBlock (const char *Block,uint8_t Len) { return PutUARTRun(Block,Len,false); }
+uint8_t PutUARTBlockP(PGM_P       Block,uint8_t Len) { return PutUARTRun(Block,Len,true ); }
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -191,19 +258,39 @@ bool PutUARTByte(char OutChar) {
 char GetUARTByte(void) {
     char    OutChar = 0;
 
-    _CLR_BIT(UCSR0B,RXCIE0);                     // Disable UART interrupts
-
-    if( UART.Rx_FIFO_In != UART.Rx_FIFO_Out ) {
-        OutChar = UART.Rx_FIFO[UART.Rx_FIFO_Out];
-        UART.Rx_FIFO_Out = (UART.Rx_FIFO_Out+1) & IFIFO_WRAP;
+    if( !RING_EMPTY(UART.Rx_FIFO) ) {
+        OutChar = RING_PEEK(UART.Rx_FIFO);
+        RING_SKIP(UART.Rx_FIFO);
         }
 
-    _SET_BIT(UCSR0B,RXCIE0);                    // Enable UART interrupts
+    //
+    // Let the host resume once we've caught up. The ISR only sets Throttled when the
+    //   FIFO is nearly full, so it can't be racing with us here.
+    //
+    if( UART.Throttled && RING_COUNT(UART.Rx_FIFO) <= UART_XON_LEVEL ) {
+        UART.Throttled = false;
+        UART.FlowChar  = XON;
+        START_TX;
+        }
 
     return(OutChar);
     }
 
 
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTAvail - Return number of chars waiting in the Rx FIFO
+//
+// Inputs:      None
+//
+// Outputs:     Number of chars GetUARTByte() can return
+//
+// For binary input, where a NUL from GetUARTByte() may be data.
+//
+uint8_t UARTAvail(void) { return( RING_COUNT(UART.Rx_FIFO) ); }
+
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -214,38 +301,235 @@ char GetUARTByte(void) {
 // Outputs:     TRUE  if UART is busy sending output
 //              FALSE if UART is idle
 //
-bool UARTBusy(void) { return( UART.Tx_FIFO_In != UART.Tx_FIFO_Out ); }
+bool UARTBusy(void) { return( !RING_EMPTY(UART.Tx_FIFO) ); }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTFree - Return free space in the Tx FIFO
+//
+// Inputs:      None
+//
+// Outputs:     Number of chars that can be sent without waiting
+//
+uint8_t UARTFree(void) { return RING_FREE(UART.Tx_FIFO); }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTDivisor - Calculate the baud rate register value for a baud rate
+//
+// Inputs:      Baud rate wanted
+//              Clock divisor (16 for normal speed, 8 for double speed)
+//              Where to put the UBRR value
+//
+// Outputs:     TRUE  if the rate is within UART_MAX_ERROR
+//              FALSE if not, or out of range
+//
+static bool UARTDivisor(uint32_t Baud,uint8_t Div,uint16_t *UBRR) {
+    uint32_t    Clocks;
+    uint32_t    Actual;
+    uint32_t    Error;
+
+    if( Baud == 0 || Baud > F_CPU/8 )
+        return(false);
+
+    Clocks = (F_CPU/Div + Baud/2)/Baud;     // == UBRR+1, rounded
+
+    if( Clocks == 0 || Clocks > 4096 )      // UBRR is 12 bits
+        return(false);
+
+    Actual = F_CPU/(Div*Clocks);
+    Error  = Actual > Baud ? Actual - Baud : Baud - Actual;
+
+    if( Error*1000 > Baud*UART_MAX_ERROR )
+        return(false);
+
+    *UBRR = Clocks - 1;
+    return(true);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTSetBaud - Change the baud rate
+//
+// Normal speed samples each bit more times and tolerates more clock error at the
+//   far end, so use double speed only if the normal divider is too far off.
+//
+// Inputs:      New baud rate
+//
+// Outputs:     TRUE  if rate was set
+//              FALSE if rate can't be reached within UART_MAX_ERROR (no change)
+//
+bool UARTSetBaud(uint32_t Baud) {
+    uint16_t    UBRR;
+    bool        Use2X = false;
+
+    if( !UARTDivisor(Baud,16,&UBRR) ) {
+        if( !UARTDivisor(Baud,8,&UBRR) )
+            return(false);
+        Use2X = true;
+        }
+
+    //
+    // Let pending output finish at the old rate. The Tx ISR clears TXC0 with each
+    //   char, so it comes on once the last one has left the shift register. The
+    //   wait is bounded in case nothing was ever sent.
+    //
+    if( _BIT_ON(UCSR0B,TXEN0) ) {
+        while( UARTBusy() && !UART.Stopped );
+
+        for( uint16_t Wait = 0xFFFF; Wait && _BIT_OFF(UCSR0A,TXC0); Wait-- );
+        }
+
+    UART.Baud = Baud;
+    UBRR0H    = UBRR >> 8;
+    UBRR0L    = UBRR;
+    if( Use2X ) _SET_BIT(UCSR0A,U2X0)
+    else        _CLR_BIT(UCSR0A,U2X0);
+
+    return(true);
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTGetBaud - Return the current baud rate
+//
+// Inputs:      None.
+//
+// Outputs:     Baud rate as requested by the last UARTSetBaud()
+//
+uint32_t UARTGetBaud(void) { return UART.Baud; }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTSetFlow - Turn XON/XOFF flow control on or off
+//
+// Turning it off releases both sides: we resume sending, and if we had stopped the
+//   host, we tell it to go ahead.
+//
+// Inputs:      TRUE to enable flow control
+//
+// Outputs:     None.
+//
+void UARTSetFlow(bool Flow) {
+
+    cli();
+
+    UART.Flow = Flow;
+
+    if( !Flow ) {
+        UART.Stopped = false;
+        if( UART.Throttled ) {
+            UART.Throttled = false;
+            UART.FlowChar  = XON;
+            }
+        START_TX;
+        }
+
+    sei();
+    }
+
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTGetFlow - Return XON/XOFF flow control setting
+//
+// Inputs:      None.
+//
+// Outputs:     TRUE if flow control is on
+//
+bool UARTGetFlow(void) { return UART.Flow; }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTStopped - Return TRUE if the host has stopped output (XOFF)
+//
+// Inputs:      None.
+//
+// Outputs:     TRUE if output is held until the host sends XON
+//
+bool UARTStopped(void) { return UART.Stopped; }
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 // USART_RX_vect - Handle input received chars
 //
-// Get the input character and place it into the Rx_FIFO.
+// Get the input character and place it into the Rx_FIFO, counting errors and
+//   handling flow control along the way.
 //
 // Inputs:      None. (ISR)
 //
 // Outputs:     None.
 //
 ISR(USART_RX_vect) {
-    uint8_t NewIn;
+    uint8_t Status;
     char    NewChar;
 
+    Status  = UCSR0A;                       // Errors must be read before data
     NewChar = UDR0;                         // Get data, clear errors
 
     //
-    // If there's room in the buffer, add the new char
+    // An overrun means an earlier char was lost, but this one is good
+    //
+    if( Status & _PIN_MASK(DOR0) )
+        UARTStats.Overrun++;
+
+    //
+    // A framing error means this char is garbage
     //
-    NewIn = (UART.Rx_FIFO_In+1) & IFIFO_WRAP;
+    if( Status & _PIN_MASK(FE0) ) {
+        UARTStats.Framing++;
+        return;
+        }
 
-    if( NewIn != UART.Rx_FIFO_Out ) {
-        UART.Rx_FIFO[UART.Rx_FIFO_In] = NewChar;
-        UART.Rx_FIFO_In               = NewIn;
+    //
+    // Flow control chars from the host stop and start our output
+    //
+    if( UART.Flow ) {
+        if( NewChar == XOFF ) {
+            UART.Stopped = true;
+            return;
+            }
+
+        if( NewChar == XON ) {
+            UART.Stopped = false;
+            START_TX;
+            return;
+            }
         }
 
     //
     // No room - Drop the character
     //
+    if( RING_FULL(UART.Rx_FIFO) ) {
+        UARTStats.Full++;
+        return;
+        }
+
+    RING_PUT(UART.Rx_FIFO,NewChar);
+
+    //
+    // Ask the host to stop while there's still room for what it has in flight
+    //
+    if( UART.Flow       &&
+        !UART.Throttled &&
+        RING_COUNT(UART.Rx_FIFO) >= UART_XOFF_LEVEL ) {
+        UART.Throttled = true;
+        UART.FlowChar  = XOFF;
+        START_TX;
+        }
     }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -256,18 +540,28 @@ ISR(USART_RX_vect) {
 // Pull the next character to be sent from the TX_FIFO and send it. If no
 //   more, turn off interrupt.
 //
+// Flow control chars go ahead of the FIFO, and are sent even when the host has
+//   stopped us.
+//
 // Inputs:      None. (ISR)
 //
 // Outputs:     None.
 //
 ISR(USART_UDRE_vect) {
 
+    if( UART.FlowChar ) {
+        UDR0 = UART.FlowChar;
+        UART.FlowChar = 0;
+        CLEAR_TXC;
+        }
+
     //
     // If more chars are available, queue one up.
     //
-    if( UART.Tx_FIFO_In != UART.Tx_FIFO_Out ) {
-        UDR0             = UART.Tx_FIFO[UART.Tx_FIFO_Out];
-        UART.Tx_FIFO_Out = (UART.Tx_FIFO_Out+1) & OFIFO_WRAP;
+    else if( !UART.Stopped && !RING_EMPTY(UART.Tx_FIFO) ) {
+        UDR0 = RING_PEEK(UART.Tx_FIFO);
+        RING_SKIP(UART.Tx_FIFO);
+        CLEAR_TXC;
         }
 
     //
@@ -19,6 +19,14 @@
 //
 //      If( UARTBusy() ) ...                // TRUE if sending something
 //
+//      if( UARTSetBaud(500000) ) ...       // Change baud rate, TRUE if attainable
+//
+//      UARTSetFlow(true);                  // Turn on XON/XOFF flow control
+//
+//      UARTStats.Framing                   // Count of Rx framing errors
+//      UARTStats.Overrun                   // Count of Rx hardware overruns
+//      UARTStats.Full                      // Count of chars dropped, Rx FIFO full
+//
 //  DESCRIPTION
 //
 //      A simple serial Rx/Tx driver module for interrupt driven communications
@@ -31,14 +39,25 @@
 //      (Also, this module can be stepped through and debugged more readily than
 //         the stdio system.)
 //
-//      The baud rate and FIFO sizes are set in the UART.h file.
+//      The startup baud rate and FIFO sizes are set in the UART.h file. The baud
+//        rate can be changed at runtime, up to 1M baud (using double speed mode
+//        when the normal divider can't get close enough).
+//
+//      Received chars with framing errors are thrown away. Framing errors, hardware
+//        overruns (a char lost because the ISR was late), and chars dropped for lack
+//        of Rx FIFO space are counted in UARTStats.
+//
+//      With flow control on, an XOFF is sent when the Rx FIFO reaches UART_XOFF_LEVEL
+//        chars and an XON once it drains to UART_XON_LEVEL. Received XOFF and XON
+//        chars pause and resume transmission, and are not passed on.
 //
 //  NOTES:
 //
 //      This interface WILL NOT receive a NUL character (ascii 0). This is on
 //        purpose, to make for a simple interface.
 //
-//      This interface DOES NOT detect UART or overflow errors.
+//      The error counters are updated from the ISR, so a reader may rarely see a
+//        torn 16-bit value. They are for display, not for control.
 //
 //      These are not the putc() and getc() functions required for stdio
 //        by WinAVR. See serial.h for those.
@@ -73,7 +92,9 @@
 #define UART_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <avr/wdt.h>
+#include <avr/pgmspace.h>
 
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -83,18 +104,51 @@
 #endif
 
 //
-// The serial FIFO's must be a power of two long each, since the code
-//   uses binary wraparounds to access. This system has NO error detection
-//   and NO XON/XOFF processing.
+// The serial FIFO's must be a power of two long each (max 256), since they are
+//   rings (Ring.h) with binary wraparounds.
+//
+// The Rx FIFO needs to hold the chars that arrive after an XOFF is sent, before
+//   the host stops. USB serial adapters can take several chars to react.
 //
 #ifndef IFIFO_SIZE
-#define IFIFO_SIZE      (1 << 3)        // == 8  char Rx FIFO
+#define IFIFO_SIZE      (1 << 5)        // == 32 char Rx FIFO
 #endif
 
 #ifndef OFIFO_SIZE
 #define OFIFO_SIZE      (1 << 6)        // == 64 chars Tx FIFO
 #endif
 
+//
+// Flow control thresholds, in chars waiting in the Rx FIFO
+//
+#define UART_XOFF_LEVEL ((IFIFO_SIZE*3)/4)
+#define UART_XON_LEVEL  ( IFIFO_SIZE   /4)
+
+#define UART_FLOW       false           // Startup flow control setting
+
+//
+// Largest allowed baud rate error, in tenths of a percent. 115200 baud is 2.1% off
+//   at 16 MHz, and works with most hosts.
+//
+#define UART_MAX_ERROR  25              // == 2.5%
+
+//
+// End of user configurable options
+//
+//////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#define XON             '\021'         // Ctrl-Q
+#define XOFF            '\023'         // Ctrl-S
+
+typedef struct {
+    volatile uint16_t   Framing;        // Chars thrown away with framing errors
+    volatile uint16_t   Overrun;        // Hardware overruns (chars lost before ISR)
+    volatile uint16_t   Full;           // Chars dropped because Rx FIFO was full
+    } UART_STATS;
+
+extern UART_STATS UARTStats;
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -139,6 +193,23 @@ bool PutUARTByte(char OutChar);
 //
 #define PutUARTByteW(_OutChar_) { while(!PutUARTByte(_OutChar_)); }
 
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// PutUARTBlock  - Send a block of RAM     chars out the serial port
+// PutUARTBlockP - Send a block of PROGMEM chars out the serial port
+//
+// Like PutUARTByte, but copies as much of the block as will fit into the FIFO, and
+//   hands it to the ISR all at once.
+//
+// Inputs:      Chars to send
+//              Number of chars
+//
+// Outputs:     Number of chars sent, which is less than Len if the FIFO filled
+//
+uint8_t PutUARTBlock (const char *Block,uint8_t Len);
+uint8_t PutUARTBlockP(PGM_P       Block,uint8_t Len);
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -154,6 +225,19 @@ bool PutUARTByte(char OutChar);
 //
 char GetUARTByte(void);
 
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTAvail - Return number of chars waiting in the Rx FIFO
+//
+// Inputs:      None.
+//
+// Outputs:     Number of chars GetUARTByte() can return
+//
+// For binary input, where a NUL from GetUARTByte() may be data.
+//
+uint8_t UARTAvail(void);
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -166,4 +250,74 @@ char GetUARTByte(void);
 //
 bool UARTBusy(void);
 
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTFree - Return free space in the Tx FIFO
+//
+// Inputs:      None.
+//
+// Outputs:     Number of chars that can be sent without waiting
+//
+uint8_t UARTFree(void);
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTSetBaud - Change the baud rate
+//
+// Waits for pending output to finish at the old rate, then switches. Uses double
+//   speed mode only if the normal divider is too far off.
+//
+// Inputs:      New baud rate
+//
+// Outputs:     TRUE  if rate was set
+//              FALSE if rate can't be reached within UART_MAX_ERROR (no change)
+//
+bool UARTSetBaud(uint32_t Baud);
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTGetBaud - Return the current baud rate
+//
+// Inputs:      None.
+//
+// Outputs:     Baud rate as requested by the last UARTSetBaud()
+//
+uint32_t UARTGetBaud(void);
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTSetFlow - Turn XON/XOFF flow control on or off
+//
+// Inputs:      TRUE to enable flow control
+//
+// Outputs:     None.
+//
+void UARTSetFlow(bool Flow);
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTGetFlow - Return XON/XOFF flow control setting
+//
+// Inputs:      None.
+//
+// Outputs:     TRUE if flow control is on
+//
+bool UARTGetFlow(void);
+
+///////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// UARTStopped - Return TRUE if the host has stopped output (XOFF)
+//
+// Inputs:      None.
+//
+// Outputs:     TRUE if output is held until the host sends XON
+//
+bool UARTStopped(void);
+
 #endif // UART_H - entire file
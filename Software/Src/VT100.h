@@ -12,6 +12,16 @@
 //      Definitions for VT100 escape code functions. These are all ANSII
 //        standard and widely published.
 //
+//      CURSOR_AT() is the cursor positioning string itself, to begin a PrintF()
+//        template, so that the position and the field go out as one block.
+//
+//      CursorSave and CursorRestore are the DECSC and DECRC sequences: the terminal
+//        remembers the cursor position, and returns to it later.
+//
+//      CursorMark notes that the cursor is where the last output left it, and
+//        CursorMoved is TRUE once any later output may have moved it. Positioning
+//        can be skipped while the cursor is still known.
+//
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 //  MIT LICENSE
@@ -50,6 +60,14 @@
 #define ClearEOS            PrintStringP(PSTR("\033[J" ));
 #define ClearEOL            PrintStringP(PSTR("\033[K" ));
 #define CursorHome          PrintStringP(PSTR("\033[H" ));
-#define CursorPos(_x_,_y_)  PrintStringP(PSTR("\033[" __xstr__(_y_) ";" __xstr__(_x_) "H"))
+#define CursorPos(_x_,_y_)  PrintStringP(PSTR(CURSOR_AT(_x_,_y_)))
+
+#define CURSOR_AT(_x_,_y_)  "\033[" __xstr__(_y_) ";" __xstr__(_x_) "H"
+
+#define CursorSave          PrintStringP(PSTR("\0337"  ));
+#define CursorRestore       PrintStringP(PSTR("\0338"  ));
+
+#define CursorMark          SerialMarkCursor();
+#define CursorMoved         SerialCursorMoved()
 
 #endif  // VT100_H - Entire file 